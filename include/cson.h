@@ -4,5 +4,12 @@
 
 #include "cson_parser.h"
 #include "cson_common.h"
+#include "cson_simd.h"
+#include "cson_number.h"
+#include "cson_arena.h"
+#include "cson_intern.h"
+#include "cson_tape.h"
+#include "cson_ondemand.h"
+#include "cson_writer.h"
 
 #endif // CSON_H__
\ No newline at end of file
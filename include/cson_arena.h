@@ -0,0 +1,40 @@
+#pragma once
+#ifndef CSON_ARENA_H__
+#define CSON_ARENA_H__
+
+#include "cson_common.h"
+
+#define CSON_ARENA_BLOCK_SIZE (64 * 1024)
+#define CSON_ARENA_ALIGNMENT 16
+
+typedef struct __json_arena_block {
+	struct __json_arena_block *next;
+	size_t used, size;
+	char data[] __attribute__((aligned(CSON_ARENA_ALIGNMENT)));
+} json_arena_block_t;
+
+// Bump allocator for trees that are dropped as a whole. Nodes, buckets and strings
+// are carved out of large blocks and json_arena_free releases only the blocks.
+// Freeing or growing anything but the most recent allocation is a no-op or a copy,
+// the space is reclaimed together with the arena.
+typedef struct {
+	json_arena_block_t *blocks;
+	size_t block_size;
+	void *last;
+	// Where the blocks themselves come from.
+	const json_allocator_t *upstream;
+	// Hand &arena->allocator to json_parser_init_with_allocator or the container
+	// init functions, the arena must not move while it is in use.
+	json_allocator_t allocator;
+} json_arena_t;
+
+// A block_size of 0 selects CSON_ARENA_BLOCK_SIZE. Blocks are allocated from
+// `upstream` (NULL selects json_default_allocator).
+int32_t json_arena_init(json_arena_t *arena, size_t block_size, const json_allocator_t *upstream);
+void *json_arena_alloc(json_arena_t *arena, size_t size);
+// Forgets every allocation but keeps the newest block, so an arena reused for
+// one document after another stops touching malloc once it is warmed up.
+int32_t json_arena_reset(json_arena_t *arena);
+int32_t json_arena_free(json_arena_t *arena);
+
+#endif // CSON_ARENA_H__
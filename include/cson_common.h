@@ -11,6 +11,8 @@
 #include <string.h>
 #include <assert.h>
 
+#include "cson_trace.h"
+
 #define CSON_ERR_NULL_PTR -1
 #define CSON_ERR_ALLOC -2
 #define CSON_ERR_INVALID_ARGUMENT -4
@@ -18,16 +20,15 @@
 #define CSON_ERR_MAX_SIZE_REACHED -6
 #define CSON_ERR_NOT_FOUND -7
 
-#define __CSON_DEBUG
-
+// Define __CSON_DEBUG to count and trace every allocation.
 #ifdef __CSON_DEBUG
-#define debug_printf(...) printf(__VA_ARGS__)
+#define debug_printf(...) json_trace(__VA_ARGS__)
 void debug_free(void *ptr);
 void *debug_malloc(size_t size);
 void *debug_calloc(const size_t num_elements, const size_t element_size);
 void *debug_realloc(void *ptr, size_t size);
 #else
-#define debug_printf(...) {}
+#define debug_printf(...) ((void)0)
 #define debug_free(ptr) free(ptr)
 #define debug_malloc(size) malloc(size)
 #define debug_calloc(num, size) calloc(num, size)
@@ -38,6 +39,38 @@ void *debug_realloc(void *ptr, size_t size);
 
 #define CSON_EXPECT 10
 
+// Where a tree gets its memory from. Every size handed back to realloc and free is
+// the one the block was allocated with, so slab and arena allocators need no
+// bookkeeping of their own. A NULL allocator anywhere means json_default_allocator.
+typedef struct {
+	void *(*malloc)(void *ctx, size_t size);
+	void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+	void (*free)(void *ctx, void *ptr, size_t size);
+	void *ctx;
+} json_allocator_t;
+
+// malloc, realloc and free (through the debug_* wrappers).
+extern const json_allocator_t json_default_allocator;
+
+static inline const json_allocator_t *json_allocator_resolve(const json_allocator_t *allocator) {
+	return allocator ? allocator : &json_default_allocator;
+}
+
+static inline void *json_allocator_malloc(const json_allocator_t *allocator, size_t size) {
+	allocator = json_allocator_resolve(allocator);
+	return allocator->malloc(allocator->ctx, size);
+}
+
+static inline void *json_allocator_realloc(const json_allocator_t *allocator, void *ptr, size_t old_size, size_t new_size) {
+	allocator = json_allocator_resolve(allocator);
+	return allocator->realloc(allocator->ctx, ptr, old_size, new_size);
+}
+
+static inline void json_allocator_free(const json_allocator_t *allocator, void *ptr, size_t size) {
+	allocator = json_allocator_resolve(allocator);
+	allocator->free(allocator->ctx, ptr, size);
+}
+
 struct __json_object;
 struct __json_array;
 struct __json_bucket;
@@ -72,34 +105,131 @@ typedef struct {
 	};
 } json_number_t;
 
+// Strings of up to CSON_STRING_INLINE_CAPACITY bytes (14 on 64-bit targets) are
+// stored inline, over `buf` and `size`, and cost no allocation. The sign of `size` tells the kinds apart:
+//  - negative: inline and NUL-terminated, `buf` is not a pointer,
+//  - 0 with a `buf`: borrowed, a view into input that outlives it (see
+//    CSON_PARSER_OPTION_ZERO_COPY), not NUL-terminated and never freed,
+//  - positive: the capacity of an owned heap `buf`.
+// Read the bytes through json_string_data unless the string is known not to be
+// inline. `hash` caches json_hash_bytes of the contents, 0 until the string
+// becomes an object key (or is interned). Anything that changes the contents clears it.
+#define CSON_STRING_INLINE_CAPACITY (__SIZEOF_POINTER__ * 2 - 2)
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+// The sign byte of `size` leads the union, inline bytes follow it.
+#define CSON_STRING_INLINE_OFFSET 1
+#define CSON_STRING_INLINE_TAG 0
+#else
+#define CSON_STRING_INLINE_OFFSET 0
+#define CSON_STRING_INLINE_TAG (__SIZEOF_POINTER__ * 2 - 1)
+#endif
+
 typedef struct {
-	ssize_t length, size;
-	char *buf;
+	ssize_t length;
+	union {
+		struct {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			ssize_t size;
+			char *buf;
+#else
+			char *buf;
+			ssize_t size;
+#endif
+		};
+		char small[CSON_STRING_INLINE_CAPACITY + 2];
+	};
+	uint64_t hash;
 } json_string_t;
 
+#define json_string_is_borrowed(str) ((str)->size == 0 && (str)->buf)
+#define json_string_is_inline(str) ((str)->size < 0)
+
+// First byte of the string wherever it is stored, NULL for an empty {} string.
+static inline char *json_string_data(const json_string_t *const str) {
+	return json_string_is_inline(str) ? (char *)str->small + CSON_STRING_INLINE_OFFSET : str->buf;
+}
+
+// Empty inline string: unlike {} it has data, but it owns nothing until it
+// outgrows the inline bytes.
+static inline json_string_t json_string_empty(void) {
+	json_string_t str = {};
+	str.small[CSON_STRING_INLINE_TAG] = (char)0x80;
+	return str;
+}
+
 typedef struct {} json_null_t;
 
+// Values are 16 bytes: an 8-byte payload, a string length, a per-type tag and the
+// type, in that order. Numbers keep their kind in `num_type`. A string of up to
+// CSON_VALUE_INLINE_CAPACITY bytes is stored NUL-terminated in `small`, over the
+// payload and length, and `string_tag` is its length. A longer one is `length`
+// bytes at `buf`, either owned (CSON_VALUE_STRING_OWNED, a NUL-terminated block of
+// exactly length + 1 bytes) or borrowed from the input (CSON_VALUE_STRING_BORROWED,
+// see json_string_t). Read strings through json_value_string, build them with
+// json_value_set_string.
+#define CSON_VALUE_INLINE_CAPACITY 13
+#define CSON_VALUE_STRING_OWNED 0x80
+#define CSON_VALUE_STRING_BORROWED 0x81
+
 typedef struct {
-	json_object_type_t value_type;
 	union {
-		json_number_t number;
-		json_object_t *object;
-		json_array_t *array;
-		bool boolean;
-		json_null_t null;
-		json_string_t string;
+		struct {
+			union {
+				int64_t i64;
+				uint64_t u64;
+				double f64;
+				json_object_t *object;
+				json_array_t *array;
+				char *buf;
+				bool boolean;
+				json_null_t null;
+			};
+			uint32_t length;
+			uint8_t reserved[2];
+			union {
+				json_number_type_t num_type;
+				uint8_t string_tag;
+			};
+			json_object_type_t value_type;
+		};
+		char small[CSON_VALUE_INLINE_CAPACITY + 1];
 	};
 } json_value_t;
 
+// Borrowed view of a string value, valid while the value is neither moved nor freed.
+static inline json_string_t json_value_string(const json_value_t *const value) {
+	if (value->string_tag <= CSON_VALUE_INLINE_CAPACITY) {
+		return (json_string_t){
+			.length = value->string_tag,
+			.buf = (char *)value->small
+		};
+	}
+	return (json_string_t){
+		.length = value->length,
+		.buf = value->buf
+	};
+}
+
+static inline json_number_t json_value_number(const json_value_t *const value) {
+	return (json_number_t){
+		.num_type = value->num_type,
+		.u64 = value->u64
+	};
+}
+
+// Containers remember the allocator they were initialised with, everything they
+// own (including the strings in them) is allocated and freed through it.
 struct __json_array {
 	json_value_t *objects;
 	ssize_t length, size;
+	const json_allocator_t *allocator;
 };
 
+// One member of an object.
 struct __json_bucket {
 	json_string_t key;
 	json_value_t value;
-	struct __json_bucket *next;
 };
 
 typedef struct {
@@ -107,26 +237,58 @@ typedef struct {
 	ssize_t length, size; 
 } json_key_array_t;
 
+// Objects with up to this many members have no index and are searched linearly.
+#define CSON_OBJECT_SMALL_SIZE 8
+
+// Members sit in `buckets` in insertion order, `count` of `size` in use. Small
+// objects stop there, `ctrl` stays NULL. Larger ones are looked up through an
+// open-addressing index beside the members: one control byte per slot in
+// `ctrl`, either the top 7 bits of the key's hash or CSON_SIMD_CTRL_EMPTY /
+// CSON_SIMD_CTRL_DELETED, and the member it stands for in `slots`. A probe
+// compares a whole group of control bytes at once and only looks at the keys
+// whose fragment matched. `ctrl` and `slots` share one allocation.
 struct __json_object {
 	json_bucket_t *buckets;
-	json_string_t *keys;
 	ssize_t count, size;
+	uint8_t *ctrl;
+	uint32_t *slots;
+	// Slots in the index (a power of two) and how many more may fill up before it is rebuilt.
+	size_t capacity, growth_left;
+	const json_allocator_t *allocator;
 };
 
-int32_t json_array_init(json_array_t *array, size_t size);
-int32_t json_object_init(json_object_t *obj, size_t size);
-int32_t json_string_free(json_string_t *string);
+int32_t json_array_init(json_array_t *array, size_t size, const json_allocator_t *allocator);
+int32_t json_object_init(json_object_t *obj, size_t size, const json_allocator_t *allocator);
+// Strings do not carry an allocator, the functions below take the one of the
+// container the string lives in.
+int32_t json_string_free(json_string_t *string, const json_allocator_t *allocator);
 
-int32_t json_string_copy(json_string_t *restrict string, const json_string_t *const restrict original);
+int32_t json_string_copy(json_string_t *restrict string, const json_string_t *const restrict original, const json_allocator_t *allocator);
+// An uninitialised `copy` is initialised with copy->allocator.
 int32_t json_array_copy(json_array_t *const restrict copy, const json_array_t *const restrict obj);
 int32_t json_object_copy(json_object_t *const copy, const json_object_t *const obj);
 
-int32_t json_string_append_char(json_string_t *str, const char ch);
+int32_t json_string_own(json_string_t *str, const json_allocator_t *allocator);
+int32_t json_string_append_char(json_string_t *str, const char ch, const json_allocator_t *allocator);
+int32_t json_string_append_buf(json_string_t *str, const char *const buf, ssize_t length, const json_allocator_t *allocator);
+// Decodes a JSON string body (buf starts right after the opening quote) into out,
+// which needs room for n bytes, escapes only ever shrink it. *consumed counts the
+// closing quote. Returns CSON_ERR_INVALID_ARGUMENT for malformed strings.
+int32_t json_string_unescape(const char *const buf, size_t n, char *out, size_t *length, size_t *consumed);
 int32_t json_array_append_value(json_array_t *arr, const json_value_t *const val);
 int32_t json_array_move_value(json_array_t *arr, const json_value_t *const val);
 int32_t json_object_append_value(json_object_t *const obj, const json_string_t *const key, const json_value_t *const value);
 int32_t json_object_move_value(json_object_t *const obj, const json_string_t *const key, json_value_t *const value);
 
+bool json_string_equal(const json_string_t *const str1, const json_string_t *const str2);
+// Hash of buf[0, length) behind object indices and the intern table: a wyhash-style
+// word-at-a-time hash keyed with a random per-process seed, so colliding keys cannot
+// be prepared in advance. Build with -DCSON_HASH_SEED=<n> to pin the seed or with
+// -DCSON_HASH_FNV1A for the unseeded byte-at-a-time FNV-1a.
+uint64_t json_hash_bytes(const char *const buf, size_t length);
+// Hashes `string` once and caches the result, a key looked up over and over is
+// then matched by hash and length before its bytes are compared.
+uint64_t json_string_hash(json_string_t *string);
 int32_t json_string_cmp(const json_string_t *const str1, const json_string_t *const str2, int *res);
 int32_t json_string_cmp_str(const json_string_t *const str1, const char *const buf, int *res);
 int32_t json_object_cmp(const json_object_t *const obj1, const json_object_t *const obj2, int *res);
@@ -135,6 +297,17 @@ int32_t json_value_cmp(const json_value_t *const val1, const json_value_t *const
 
 int32_t json_array_resize(json_array_t *array, ssize_t new_size);
 int32_t json_object_rehash(json_object_t *obj, ssize_t new_size);
+// Make room for `size` elements (members) in one step, nothing happens when
+// there already is. Objects expecting more than CSON_OBJECT_SMALL_SIZE members
+// get their index right away.
+int32_t json_array_reserve(json_array_t *array, ssize_t size);
+int32_t json_object_reserve(json_object_t *obj, ssize_t size);
+// Give back the slack growth left behind, down to the current length (at least
+// one slot). `recursive` does the same for every container nested inside.
+int32_t json_array_shrink_to_fit(json_array_t *array, bool recursive);
+int32_t json_object_shrink_to_fit(json_object_t *obj, bool recursive);
+// Shrinks every container in the tree under `value`.
+int32_t json_value_shrink_to_fit(json_value_t *value);
 
 int32_t json_value_printf(const json_value_t *const val, uint64_t indent, bool start);
 int32_t json_string_printf(const json_string_t *const str);
@@ -148,7 +321,13 @@ int32_t json_array_delete_index(json_array_t *arr, const ssize_t index, json_val
 int32_t json_array_pop(json_array_t *arr, json_value_t *val);
 int32_t json_object_delete_key(json_object_t *const obj, const json_string_t *const key, json_value_t *value);
 
-int32_t json_value_free(json_value_t *val);
+// Makes `value` a string holding `string` and takes the string over, leaving it {}.
+// Short strings are copied into the value, an owned buffer is trimmed to its length.
+// CSON_ERR_MAX_SIZE_REACHED past UINT32_MAX bytes, `string` is untouched on error.
+int32_t json_value_set_string(json_value_t *value, json_string_t *string, const json_allocator_t *allocator);
+// `allocator` is only used for a string value, objects and arrays are freed
+// (struct included) with their own.
+int32_t json_value_free(json_value_t *val, const json_allocator_t *allocator);
 int32_t json_array_free(json_array_t *array);
 int32_t json_object_free(json_object_t *obj);
 
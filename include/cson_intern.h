@@ -0,0 +1,36 @@
+#pragma once
+#ifndef CSON_INTERN_H__
+#define CSON_INTERN_H__
+
+#include "cson_common.h"
+
+#define CSON_INTERN_CHUNK_SIZE (16 * 1024)
+
+typedef struct __json_intern_chunk {
+	struct __json_intern_chunk *next;
+	size_t used, size;
+	char data[];
+} json_intern_chunk_t;
+
+// Set of unique key strings. Every distinct key is copied once into append-only
+// chunks that never move, so the views handed out stay valid until the table is
+// freed and equal keys always share one buffer. The set itself is open addressing
+// with linear probing over the strings' cached hashes, it doubles at half load
+// without hashing anything again.
+typedef struct {
+	json_string_t *strings;
+	size_t count, capacity;
+	json_intern_chunk_t *chunks;
+	const json_allocator_t *allocator;
+} json_intern_table_t;
+
+// NULL selects json_default_allocator, it backs the set and the chunks.
+int32_t json_intern_init(json_intern_table_t *table, const json_allocator_t *allocator);
+// Points `interned` at the table's copy of buf[0, length), adding one if needed. The
+// result is a NUL-terminated borrowed view with its hash cached, json_string_free
+// leaves it alone.
+int32_t json_intern(json_intern_table_t *table, const char *const buf, size_t length, json_string_t *interned);
+// Every view handed out dies with the table, free it after the values using them.
+int32_t json_intern_free(json_intern_table_t *table);
+
+#endif // CSON_INTERN_H__
@@ -0,0 +1,49 @@
+#ifndef CSON_NUMBER_H__
+#define CSON_NUMBER_H__
+
+#include "cson_common.h"
+
+// Significant decimal digits that always fit in a uint64_t mantissa.
+#define CSON_NUMBER_MAX_DIGITS 19
+#define CSON_NUMBER_SMALLEST_POWER_OF_TEN -342
+#define CSON_NUMBER_LARGEST_POWER_OF_TEN 308
+// Room for json_number_format_f64, whose longest output ("-0.00000" and 17 digits) is 25 bytes.
+#define CSON_NUMBER_F64_MAX_LENGTH 32
+
+// True when all 8 bytes at p are ASCII digits.
+static inline bool json_number_is_eight_digits(const char *const p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return ((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+// Value of the 8 ASCII digits at p, combined pairwise in a single register.
+static inline uint32_t json_number_parse_eight_digits(const char *const p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	v -= 0x3030303030303030ULL;
+	v = v * 10 + (v >> 8);
+	v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+	return (uint32_t)v;
+}
+
+// Converts w * 10^q to the nearest double with the Clinger fast path and, failing
+// that, the Eisel-Lemire algorithm. Returns false when the result cannot be
+// proven correctly rounded, the caller then has to take the slow path.
+bool json_number_compute_float(uint64_t w, int64_t q, bool negative, double *out);
+// Exact conversion of the significant digits in `digits` times 10^q.
+int32_t json_number_parse_slow(const char *const digits, ssize_t count, int64_t q, bool negative, double *out);
+// Parses the JSON number at the start of buf[0, n) and reports how many bytes it took.
+// Negative integers become I64, other integers U64 and everything else (or whatever
+// overflows those) F64. Returns CSON_ERR_INVALID_ARGUMENT for malformed numbers.
+int32_t json_number_scan(const char *const buf, size_t n, json_number_t *number, size_t *consumed);
+// Writes a finite `value` into buf (at least CSON_NUMBER_F64_MAX_LENGTH bytes) with
+// Grisu2, which reads back to the same double and is nearly always the shortest
+// such digit string. There is always a '.' or an exponent so it reads back as a
+// double. Returns the length, buf is not NUL-terminated.
+size_t json_number_format_f64(double value, char *buf);
+
+#endif // CSON_NUMBER_H__
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef CSON_ONDEMAND_H__
+#define CSON_ONDEMAND_H__
+
+#include "cson_common.h"
+#include "cson_parser.h"
+
+// A position inside raw input, pointing at the first byte of a value. Nothing is
+// parsed until it is asked for: looking up a field walks the object's keys and
+// skips every value in between with a bracket-depth scan, so subtrees nobody reads
+// are never materialized. The input must outlive every cursor into it.
+// Only what is visited gets validated, a malformed subtree that is skipped over
+// may go unnoticed.
+typedef struct {
+	const char *input;
+	size_t length;
+	size_t pointer;
+} json_cursor_t;
+
+// Positions `cursor` at the root value of data[0, len).
+int32_t json_doc_init(json_cursor_t *cursor, const char *const data, size_t len);
+// Type of the value under the cursor, judged by its first byte. __JSON_OBJECT_TYPE_MAX
+// when that byte cannot start a value.
+json_object_type_t json_doc_type(const json_cursor_t *const cursor);
+// Points `field` at the value of `key` in the object under `object`, CSON_ERR_NOT_FOUND
+// when there is no such key. Keys are compared after unescaping.
+int32_t json_doc_get_field(const json_cursor_t *const object, const char *const key, json_cursor_t *field);
+// Points `element` at the index-th element of the array under `array`.
+int32_t json_doc_get_index(const json_cursor_t *const array, size_t index, json_cursor_t *element);
+// A string without escapes is returned as a borrowed view into the input, anything
+// else is unescaped into a buffer from `allocator`. Either way json_string_free
+// with the same allocator releases it.
+int32_t json_doc_get_string(const json_cursor_t *const cursor, json_string_t *string, const json_allocator_t *allocator);
+int32_t json_doc_get_number(const json_cursor_t *const cursor, json_number_t *number);
+int32_t json_doc_get_bool(const json_cursor_t *const cursor, bool *boolean);
+// Builds the subtree under the cursor with json_parse_buffer, which frees `parser`.
+int32_t json_doc_get_value(const json_cursor_t *const cursor, json_parser_t *const parser, json_value_t *value);
+
+// Builds an ordinary tree holding only what the JSON Pointers (RFC 6901) in the
+// NULL-terminated `paths` select, plus the objects and arrays on the way to it.
+// Everything else is skipped with the bracket-depth scan and never allocated.
+// Array elements in front of a selected one are kept as nulls so indices still
+// line up, containers in which no pointer resolved are left out. CSON_ERR_NOT_FOUND
+// when nothing is selected at all. Frees `parser` like json_parse_buffer does and
+// honours its allocator and options.
+int32_t json_parse_projected(json_parser_t *const parser, json_value_t *value, const char *const data, size_t len, const char *const *paths);
+
+#endif // CSON_ONDEMAND_H__
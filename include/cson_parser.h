@@ -2,8 +2,15 @@
 #define CSON_PARSER_H__
 
 #define BUFFER_SIZE 8192
+#define CSON_MMAP_WINDOW_SIZE (1 << 20)
+// Longest escape sequence, a surrogate pair such as "\uD83D\uDE00".
+#define CSON_PARSER_ESCAPE_MAX 12
 
 #include "cson_common.h"
+#include "cson_simd.h"
+#include "cson_number.h"
+#include "cson_arena.h"
+#include "cson_intern.h"
 
 #define CSON_PARSER_FLAG_FOUND_SIGN 1
 #define CSON_PARSER_FLAG_FOUND_PERIOD 2
@@ -18,6 +25,23 @@
 #define CSON_PARSER_FLAG_FOUND_STRING_START 1024
 #define CSON_PARSER_FLAG_FOUND_TRAILING_COMMA 2048
 
+// Strings and keys are views into the input instead of heap copies, unescaped
+// into their own buffer only when they contain a backslash. Only honoured when
+// the input outlives the result: json_parse_buffer and json_parse_mmap.
+#define CSON_PARSER_OPTION_ZERO_COPY 1
+// Set by json_parse_insitu: strings are views into the caller's writable
+// buffer, unescaped in place and NUL-terminated over their closing quote.
+#define CSON_PARSER_OPTION_INSITU 2
+// json_parse_mmap allocates the tree from an arena owned by the document, so
+// json_document_free releases a few large blocks instead of walking every node.
+#define CSON_PARSER_OPTION_ARENA 4
+// json_parse_mmap interns keys into a table owned by the document, unless the
+// caller already set parser->intern. Other entry points only intern through that.
+#define CSON_PARSER_OPTION_INTERN_KEYS 8
+// Owned keys are trimmed to their length. The tree parser sizes containers exactly
+// anyway, json_parse_projected also shrinks the ones it grew while filling them.
+#define CSON_PARSER_OPTION_EXACT_SIZE 16
+
 typedef enum {
 	CSON_PARSER_STATE_IDLE,
 	CSON_PARSER_STATE_OBJECT,
@@ -41,8 +65,23 @@ typedef struct {
 	bool found_number_after_period;
 	bool found_number_after_exponent;
 	bool found_number_after_sign;
+	// Pending double as mantissa * 10^decimal_exponent, converted once in validate_number.
+	bool number_pending;
+	int32_t mantissa_digits;
+	uint64_t mantissa;
+	int64_t decimal_exponent;
+	// Every significant digit, only kept once mantissa_digits exceeds CSON_NUMBER_MAX_DIGITS.
+	json_string_t number_digits;
 	json_value_t value;
+	// The string value being read, moved into its json_value_t at the closing quote.
+	json_string_t string;
+	// An escape sequence cut off by the end of a buffer, decoded once it is complete.
+	char escape[CSON_PARSER_ESCAPE_MAX];
+	uint8_t escape_length;
 	uint16_t parser_flag;
+	uint32_t options;
+	// Whole input for json_parse_buffer and json_parse_mmap, NULL while streaming through buf.
+	const char *input;
 	ssize_t pointer;
 	ssize_t depth_count, depth_size;
 	ssize_t *depth;
@@ -51,11 +90,50 @@ typedef struct {
 	ssize_t key_count, key_size;
 	json_string_t *temporary_keys;
 	json_array_t temporaries;
+	json_structural_index_t index;
+	// Backs every container and string the parser creates, the parsed tree included.
+	const json_allocator_t *allocator;
+	// Backs the parser's own stacks and index, which never outlive it.
+	const json_allocator_t *scratch_allocator;
+	// When set, every key is replaced by its view from this table, so equal keys share
+	// one buffer across the tree (or across documents parsed with the same table).
+	json_intern_table_t *intern;
 	char buf[BUFFER_SIZE];
 } json_parser_t;
 
+// A parsed tree together with the input it was parsed from. For json_parse_mmap
+// the input is a read-only mapping of the file that stays valid until
+// json_document_free, so values may refer into it.
+typedef struct {
+	json_value_t root;
+	const char *input;
+	size_t input_length;
+	void *mapping;
+	size_t mapping_length;
+	// The allocator the parser was set up with. The document's arena and intern table
+	// come from it, and so does the tree unless the arena owns it.
+	const json_allocator_t *allocator;
+	// Set with CSON_PARSER_OPTION_ARENA, owns the whole tree.
+	json_arena_t *arena;
+	// Set with CSON_PARSER_OPTION_INTERN_KEYS, owns the tree's keys.
+	json_intern_table_t *intern;
+} json_document_t;
+
 int32_t json_parser_free(json_parser_t *parser);
 int32_t json_parser_init(json_parser_t *const parser);
+// Same as json_parser_init, but everything the parser allocates comes from `allocator`
+// (NULL selects json_default_allocator). Values it returns must be freed with the same one.
+int32_t json_parser_init_with_allocator(json_parser_t *const parser, const json_allocator_t *allocator);
 int32_t json_parse(json_parser_t *const parser, json_value_t *value, const char *const filename);
+int32_t json_parse_mmap(json_parser_t *const parser, json_document_t *document, const char *const filename);
+// Parses `len` bytes the caller already holds in memory, without copying them.
+int32_t json_parse_buffer(json_parser_t *const parser, json_value_t *value, const char *const data, size_t len);
+// Same as json_parse_buffer, but the caller guarantees CSON_PADDING readable
+// bytes after data[len - 1] so the SIMD kernels never have to copy the tail.
+int32_t json_parse_buffer_padded(json_parser_t *const parser, json_value_t *value, const char *const data, size_t len);
+// Destructive parse of a writable buffer: strings and keys are decoded in place
+// and point into `data`, which must outlive `value`. Nothing is allocated per string.
+int32_t json_parse_insitu(json_parser_t *const parser, json_value_t *value, char *const data, size_t len);
+int32_t json_document_free(json_document_t *document);
 
 #endif // CSON_PARSER_H__
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef CSON_SIMD_H__
+#define CSON_SIMD_H__
+
+#include "cson_common.h"
+
+#define CSON_SIMD_BLOCK_SIZE 64
+// Bytes that must stay readable past the end of an input for the kernels to
+// load whole blocks without copying the tail first.
+#define CSON_PADDING CSON_SIMD_BLOCK_SIZE
+
+// Bitmasks for one 64-byte block, bit i is set when block[i] matches.
+typedef struct {
+	uint64_t structural;
+	uint64_t quote;
+	uint64_t backslash;
+} json_simd_block_t;
+
+// Positions of every structural character ('{', '}', '[', ']', ':', ','),
+// quote and backslash inside the buffer handed to json_structural_index_build,
+// in ascending order. The parser walks them with `cursor`. `padding` is the
+// number of bytes past buf[n - 1] that may be read but are not input.
+typedef struct {
+	uint32_t *positions;
+	ssize_t count, size;
+	ssize_t cursor;
+	const json_allocator_t *allocator;
+} json_structural_index_t;
+
+void json_simd_classify_block(const char *const block, json_simd_block_t *masks);
+// Offset of the first '"', '\\' or control character in buf[0, n), or n when the
+// whole range is plain string content. Never reads past buf[n - 1].
+ssize_t json_simd_find_string_special(const char *const buf, ssize_t n);
+// Offset of the first byte in buf[0, n) that is not ' ', '\t', '\n' or '\r', or n.
+ssize_t json_simd_skip_whitespace(const char *const buf, ssize_t n);
+
+// Group kernels for the open-addressing object index. A control byte is either
+// CSON_SIMD_CTRL_EMPTY, CSON_SIMD_CTRL_DELETED or a 7-bit hash fragment, and
+// matches come back as a mask with one bit (SSE2) or byte (SWAR) per control
+// byte, the index of a match being its bit position >> CSON_SIMD_GROUP_SHIFT.
+// SSE2 is part of x86-64, so unlike the scanners above these need no runtime
+// dispatch and stay inlinable into the probe loop.
+#define CSON_SIMD_CTRL_EMPTY 0x80
+#define CSON_SIMD_CTRL_DELETED 0xFE
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CSON_SIMD_GROUP_WIDTH 16
+#define CSON_SIMD_GROUP_SHIFT 0
+
+// Control bytes equal to `byte`.
+static inline uint64_t json_simd_group_match(const uint8_t *const group, uint8_t byte) {
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+}
+
+static inline uint64_t json_simd_group_match_empty(const uint8_t *const group) {
+	return json_simd_group_match(group, CSON_SIMD_CTRL_EMPTY);
+}
+
+// Empty or deleted control bytes, the only ones with the top bit set.
+static inline uint64_t json_simd_group_match_free(const uint8_t *const group) {
+	return (uint64_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+#else
+#define CSON_SIMD_GROUP_WIDTH 8
+#define CSON_SIMD_GROUP_SHIFT 3
+#define CSON_SIMD_GROUP_LSB 0x0101010101010101ULL
+#define CSON_SIMD_GROUP_MSB 0x8080808080808080ULL
+
+static inline uint64_t json_simd_group_load(const uint8_t *const group) {
+	uint64_t ctrl;
+	memcpy(&ctrl, group, sizeof(ctrl));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	ctrl = __builtin_bswap64(ctrl);
+#endif
+	return ctrl;
+}
+
+// May also report a byte right after a real match, callers check the control byte again.
+static inline uint64_t json_simd_group_match(const uint8_t *const group, uint8_t byte) {
+	uint64_t x = json_simd_group_load(group) ^ (CSON_SIMD_GROUP_LSB * byte);
+	return (x - CSON_SIMD_GROUP_LSB) & ~x & CSON_SIMD_GROUP_MSB;
+}
+
+// 0x80 is the only control byte with the top bit set and bit 1 clear.
+static inline uint64_t json_simd_group_match_empty(const uint8_t *const group) {
+	uint64_t ctrl = json_simd_group_load(group);
+	return ctrl & ~(ctrl << 6) & CSON_SIMD_GROUP_MSB;
+}
+
+static inline uint64_t json_simd_group_match_free(const uint8_t *const group) {
+	return json_simd_group_load(group) & CSON_SIMD_GROUP_MSB;
+}
+#endif // __SSE2__
+
+int32_t json_structural_index_init(json_structural_index_t *index, ssize_t size, const json_allocator_t *allocator);
+int32_t json_structural_index_build(json_structural_index_t *index, const char *const buf, ssize_t n, ssize_t padding);
+int32_t json_structural_index_free(json_structural_index_t *index);
+
+// Returns the first indexed position at or after `pointer`, or -1 once the index is exhausted.
+static inline ssize_t json_structural_index_next(json_structural_index_t *index, ssize_t pointer) {
+	while (index->cursor < index->count && index->positions[index->cursor] < pointer) index->cursor++;
+	return index->cursor < index->count ? (ssize_t)index->positions[index->cursor] : -1;
+}
+
+// Same as json_structural_index_next, but only stops at quotes and backslashes, the
+// positions that can end a run of string content.
+static inline ssize_t json_structural_index_next_quote(json_structural_index_t *index, const char *const buf, ssize_t pointer) {
+	ssize_t next;
+	while ((next = json_structural_index_next(index, pointer)) >= 0 && buf[next] != '\"' && buf[next] != '\\') index->cursor++;
+	return next;
+}
+
+#endif // CSON_SIMD_H__
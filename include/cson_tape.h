@@ -0,0 +1,89 @@
+#pragma once
+#ifndef CSON_TAPE_H__
+#define CSON_TAPE_H__
+
+#include "cson_common.h"
+
+// A parsed document as one array of tagged 64-bit words in document order. The
+// top byte is a json_tape_type_t, the low 56 bits its payload:
+//  - OBJECT_START / ARRAY_START: index of the matching END word,
+//  - OBJECT_END / ARRAY_END: index of the matching START word,
+//  - STRING: offset into `strings` of a uint32_t length, the bytes and a NUL,
+//  - I64 / U64 / F64: nothing, the raw value is the next word.
+// Objects hold a STRING key before every value. Read-only consumers walk it
+// front to back without touching a pointer.
+typedef enum {
+	JSON_TAPE_OBJECT_START = '{',
+	JSON_TAPE_OBJECT_END = '}',
+	JSON_TAPE_ARRAY_START = '[',
+	JSON_TAPE_ARRAY_END = ']',
+	JSON_TAPE_STRING = '"',
+	JSON_TAPE_I64 = 'l',
+	JSON_TAPE_U64 = 'u',
+	JSON_TAPE_F64 = 'd',
+	JSON_TAPE_TRUE = 't',
+	JSON_TAPE_FALSE = 'f',
+	JSON_TAPE_NULL = 'n'
+} json_tape_type_t;
+
+#define JSON_TAPE_PAYLOAD_MASK ((1ULL << 56) - 1)
+
+typedef struct {
+	uint64_t *words;
+	size_t count;
+	char *strings;
+	size_t strings_length;
+	// Words and strings share one allocation of `size` bytes.
+	size_t size;
+	const json_allocator_t *allocator;
+} json_tape_t;
+
+static inline json_tape_type_t json_tape_type(const json_tape_t *const tape, size_t index) {
+	return (json_tape_type_t)(tape->words[index] >> 56);
+}
+
+static inline uint64_t json_tape_payload(const json_tape_t *const tape, size_t index) {
+	return tape->words[index] & JSON_TAPE_PAYLOAD_MASK;
+}
+
+// Index of the word following the value that starts at `index`, containers included.
+static inline size_t json_tape_next(const json_tape_t *const tape, size_t index) {
+	switch (json_tape_type(tape, index)) {
+		case JSON_TAPE_OBJECT_START:
+		case JSON_TAPE_ARRAY_START: return json_tape_payload(tape, index) + 1;
+		case JSON_TAPE_I64:
+		case JSON_TAPE_U64:
+		case JSON_TAPE_F64: return index + 2;
+		default: return index + 1;
+	}
+}
+
+static inline const char *json_tape_string(const json_tape_t *const tape, size_t index, size_t *length) {
+	const char *entry = tape->strings + json_tape_payload(tape, index);
+	uint32_t n;
+	memcpy(&n, entry, sizeof(n));
+	if (length) *length = n;
+	return entry + sizeof(n);
+}
+
+static inline int64_t json_tape_i64(const json_tape_t *const tape, size_t index) {
+	return (int64_t)tape->words[index + 1];
+}
+
+static inline uint64_t json_tape_u64(const json_tape_t *const tape, size_t index) {
+	return tape->words[index + 1];
+}
+
+static inline double json_tape_f64(const json_tape_t *const tape, size_t index) {
+	double f;
+	memcpy(&f, &tape->words[index + 1], sizeof(f));
+	return f;
+}
+
+// Parses data[0, len) into `tape` with a single allocation from `allocator` (NULL
+// selects json_default_allocator). It is sized for the worst case up front, which
+// for large inputs malloc serves with fresh pages that are only committed once written.
+int32_t json_parse_tape(json_tape_t *tape, const char *const data, size_t len, const json_allocator_t *allocator);
+int32_t json_tape_free(json_tape_t *tape);
+
+#endif // CSON_TAPE_H__
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef CSON_TRACE_H__
+#define CSON_TRACE_H__
+
+#include <stdint.h>
+
+#define CSON_TRACE_LEVEL_OFF 0
+#define CSON_TRACE_LEVEL_ERROR 1
+#define CSON_TRACE_LEVEL_TRACE 2
+
+// Picked at compile time with -DCSON_TRACE_LEVEL=..., anything above the chosen level
+// is compiled out together with the evaluation of its arguments.
+#ifndef CSON_TRACE_LEVEL
+#define CSON_TRACE_LEVEL CSON_TRACE_LEVEL_ERROR
+#endif // CSON_TRACE_LEVEL
+
+typedef void (*json_trace_sink_t)(int32_t level, const char *const file, int32_t line, const char *const message, void *user_data);
+
+// Routes messages to sink instead of stderr, NULL restores the default.
+void json_trace_set_sink(json_trace_sink_t sink, void *user_data);
+void json_trace_write(int32_t level, const char *const file, int32_t line, const char *const format, ...) __attribute__((format(printf, 4, 5)));
+
+#if CSON_TRACE_LEVEL >= CSON_TRACE_LEVEL_ERROR
+#define json_error(...) json_trace_write(CSON_TRACE_LEVEL_ERROR, __FILE__, __LINE__, __VA_ARGS__)
+#else
+#define json_error(...) ((void)0)
+#endif
+
+#if CSON_TRACE_LEVEL >= CSON_TRACE_LEVEL_TRACE
+#define json_trace(...) json_trace_write(CSON_TRACE_LEVEL_TRACE, __FILE__, __LINE__, __VA_ARGS__)
+// Structure dumps (json_value_printf and friends) write to stdout, not to the sink.
+#define json_trace_dump(...) do { __VA_ARGS__; } while (0)
+#else
+#define json_trace(...) ((void)0)
+#define json_trace_dump(...) ((void)0)
+#endif
+
+#endif // CSON_TRACE_H__
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef CSON_WRITER_H__
+#define CSON_WRITER_H__
+
+#include "cson_common.h"
+
+#define CSON_WRITER_BUFFER_SIZE (64 * 1024)
+
+// Newlines and indentation, one level per nesting depth. Without it the output
+// has no whitespace at all.
+#define CSON_SERIALIZE_PRETTY 1
+// Indent pretty output with `n` spaces per level (at most 255) instead of a tab.
+#define CSON_SERIALIZE_INDENT(n) ((uint32_t)((n) & 0xFF) << 8)
+
+// Destination of json_serialize. A memory writer grows `buf` through `allocator`
+// and the output is buf[0, length). A file descriptor writer collects output in
+// `buf` and writes it out CSON_WRITER_BUFFER_SIZE bytes at a time, whatever is
+// still buffered goes out with json_writer_flush.
+typedef struct {
+	char *buf;
+	size_t length, size;
+	// -1 for a memory writer.
+	int fd;
+	const json_allocator_t *allocator;
+} json_writer_t;
+
+// A size of 0 starts the buffer at CSON_WRITER_BUFFER_SIZE bytes.
+int32_t json_writer_init_buffer(json_writer_t *writer, size_t size, const json_allocator_t *allocator);
+// The descriptor stays the caller's, it is neither closed nor seeked.
+int32_t json_writer_init_fd(json_writer_t *writer, int fd, const json_allocator_t *allocator);
+int32_t json_writer_write(json_writer_t *writer, const char *const data, size_t length);
+// Writes out what a descriptor writer has buffered, errno when write fails.
+// Nothing to do for a memory writer.
+int32_t json_writer_flush(json_writer_t *writer);
+// Releases the buffer without flushing it.
+int32_t json_writer_free(json_writer_t *writer);
+
+// Appends `value` as JSON text to `out`. Strings are escaped as RFC 8259 asks,
+// doubles are written with the short digits of json_number_format_f64 (NaN and
+// infinities, which JSON cannot express, as null). A descriptor writer is flushed
+// before returning.
+int32_t json_serialize(const json_value_t *const value, json_writer_t *out, uint32_t flags);
+
+#endif // CSON_WRITER_H__
@@ -0,0 +1,120 @@
+#include "../include/cson_arena.h"
+
+static inline size_t json_arena_align(size_t size) {
+	return (size + CSON_ARENA_ALIGNMENT - 1) & ~((size_t)CSON_ARENA_ALIGNMENT - 1);
+}
+
+static json_arena_block_t *json_arena_block_new(json_arena_t *arena, size_t size) {
+	json_arena_block_t *block = json_allocator_malloc(arena->upstream, sizeof(json_arena_block_t) + size);
+	if (!block) {
+		json_error("Failed to allocate arena block with size %zu byte(s)", size);
+		return NULL;
+	}
+	block->next = NULL;
+	block->used = 0;
+	block->size = size;
+	return block;
+}
+
+void *json_arena_alloc(json_arena_t *arena, size_t size) {
+	if (!arena) return NULL;
+	size = json_arena_align(size ? size : 1);
+	json_arena_block_t *head = arena->blocks;
+	if (head && head->size - head->used >= size) {
+		void *ptr = head->data + head->used;
+		head->used += size;
+		arena->last = ptr;
+		return ptr;
+	}
+	// Anything larger than a block gets one of its own, linked behind the current
+	// block so the space left there is not thrown away.
+	if (size > arena->block_size && head) {
+		json_arena_block_t *block = json_arena_block_new(arena, size);
+		if (!block) return NULL;
+		block->used = size;
+		block->next = head->next;
+		head->next = block;
+		return block->data;
+	}
+	json_arena_block_t *block = json_arena_block_new(arena, size > arena->block_size ? size : arena->block_size);
+	if (!block) return NULL;
+	block->used = size;
+	block->next = head;
+	arena->blocks = block;
+	arena->last = block->data;
+	return block->data;
+}
+
+static void *json_arena_malloc_impl(void *ctx, size_t size) {
+	return json_arena_alloc(ctx, size);
+}
+
+// The most recent allocation grows and shrinks in place, anything else is copied.
+static void *json_arena_realloc_impl(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+	json_arena_t *arena = ctx;
+	if (!ptr) return json_arena_alloc(arena, new_size);
+	if (ptr == arena->last) {
+		json_arena_block_t *head = arena->blocks;
+		size_t offset = (char *)ptr - head->data;
+		size_t size = json_arena_align(new_size ? new_size : 1);
+		if (size <= head->size - offset) {
+			head->used = offset + size;
+			return ptr;
+		}
+	}
+	void *tmp = json_arena_alloc(arena, new_size);
+	if (tmp) memcpy(tmp, ptr, old_size < new_size ? old_size : new_size);
+	return tmp;
+}
+
+static void json_arena_free_impl(void *ctx, void *ptr, size_t size) {
+	(void)size;
+	json_arena_t *arena = ctx;
+	if (!ptr || ptr != arena->last) return;
+	arena->blocks->used = (char *)ptr - arena->blocks->data;
+	arena->last = NULL;
+}
+
+int32_t json_arena_init(json_arena_t *arena, size_t block_size, const json_allocator_t *upstream) {
+	if (!arena) return CSON_ERR_NULL_PTR;
+	*arena = (json_arena_t){
+		.block_size = block_size ? json_arena_align(block_size) : CSON_ARENA_BLOCK_SIZE,
+		.upstream = json_allocator_resolve(upstream),
+		.allocator = {
+			.malloc = json_arena_malloc_impl,
+			.realloc = json_arena_realloc_impl,
+			.free = json_arena_free_impl,
+			.ctx = arena
+		}
+	};
+	return 0;
+}
+
+int32_t json_arena_reset(json_arena_t *arena) {
+	if (!arena) return CSON_ERR_NULL_PTR;
+	if (!arena->blocks) return 0;
+	json_arena_block_t *curr = arena->blocks->next;
+	while (curr) {
+		json_arena_block_t *next = curr->next;
+		json_allocator_free(arena->upstream, curr, sizeof(json_arena_block_t) + curr->size);
+		curr = next;
+	}
+	arena->blocks->next = NULL;
+	arena->blocks->used = 0;
+	arena->last = NULL;
+	return 0;
+}
+
+int32_t json_arena_free(json_arena_t *arena) {
+	if (!arena) return CSON_ERR_NULL_PTR;
+	json_arena_block_t *curr = arena->blocks;
+	while (curr) {
+		json_arena_block_t *next = curr->next;
+		json_trace("Freeing arena block with size %zu byte(s)", curr->size);
+		json_allocator_free(arena->upstream, curr, sizeof(json_arena_block_t) + curr->size);
+		curr = next;
+	}
+	arena->blocks = NULL;
+	arena->last = NULL;
+	return 0;
+}
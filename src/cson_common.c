@@ -1,102 +1,429 @@
 #include "../include/cson.h"
+#include <time.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif // _WIN32
 
 #define FNV_PRIME 1099511628211LL
 #define FNV_OFFSET_BASIS 14695981039346656037ULL
 
+static void *json_default_malloc(void *ctx, size_t size) {
+	(void)ctx;
+	return debug_malloc(size);
+}
+
+static void *json_default_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+	(void)ctx;
+	(void)old_size;
+	return ptr ? debug_realloc(ptr, new_size) : debug_malloc(new_size);
+}
+
+static void json_default_free(void *ctx, void *ptr, size_t size) {
+	(void)ctx;
+	(void)size;
+	debug_free(ptr);
+}
+
+const json_allocator_t json_default_allocator = {
+	.malloc = json_default_malloc,
+	.realloc = json_default_realloc,
+	.free = json_default_free,
+	.ctx = NULL
+};
+
 int max(ssize_t l, ssize_t r) {
 	return l >= r ? l : r;
 }
 
-ssize_t json_key_hash(ssize_t bucket_size, const json_string_t *const string) {
-	if (!string || !string->buf) return CSON_ERR_NULL_PTR;
-	size_t hash = FNV_OFFSET_BASIS;
-    for (ssize_t i = 0; i < string->length; ++i) {
-		hash ^= string->buf[i];
+#ifdef CSON_HASH_FNV1A
+uint64_t json_hash_bytes(const char *const buf, size_t length) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < length; ++i) {
+		hash ^= (unsigned char)buf[i];
 		hash *= FNV_PRIME;
 	}
-    return hash % bucket_size;
+	return hash;
+}
+#else
+static const uint64_t json_hash_secret[4] = {
+	0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+};
+
+// Full 64x64 -> 128 bit product, low half into `a` and high half into `b`.
+static inline void json_hash_multiply(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t product = (__uint128_t)*a * *b;
+	*a = (uint64_t)product;
+	*b = (uint64_t)(product >> 64);
+#else
+	uint64_t ha = *a >> 32, la = (uint32_t)*a, hb = *b >> 32, lb = (uint32_t)*b;
+	uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+	uint64_t t = ll + (hl << 32);
+	uint64_t lo = t + (lh << 32);
+	*b = hh + (hl >> 32) + (lh >> 32) + (t < ll) + (lo < t);
+	*a = lo;
+#endif // __SIZEOF_INT128__
+}
+
+static inline uint64_t json_hash_mix(uint64_t a, uint64_t b) {
+	json_hash_multiply(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t json_hash_read64(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t json_hash_read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// Already mixed with the secret, as wyhash does with its seed on every call.
+static uint64_t json_hash_seed;
+
+// Picked before main so every hash cached in a string or an intern table is made
+// with the same seed for the life of the process.
+__attribute__((constructor)) static void json_hash_seed_init(void) {
+#ifdef CSON_HASH_SEED
+	uint64_t seed = CSON_HASH_SEED;
+#else
+	uint64_t seed = 0;
+#ifndef _WIN32
+	if (getentropy(&seed, sizeof(seed)))
+#endif // _WIN32
+	{
+		// No entropy source, fall back to whatever differs between runs.
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		seed = (uint64_t)now.tv_nsec ^ ((uint64_t)now.tv_sec << 32) ^ (uint64_t)(uintptr_t)&seed;
+	}
+#endif // CSON_HASH_SEED
+	json_hash_seed = seed ^ json_hash_mix(seed ^ json_hash_secret[0], json_hash_secret[1]);
+}
+
+// wyhash (final version 4): keys up to 16 bytes take two overlapping reads and a
+// single multiply, longer ones are consumed 16 or 48 bytes per round.
+uint64_t json_hash_bytes(const char *const buf, size_t length) {
+	const uint8_t *p = (const uint8_t *)buf;
+	const uint64_t *secret = json_hash_secret;
+	uint64_t seed = json_hash_seed;
+	uint64_t a, b;
+	if (length <= 16) {
+		if (length >= 4) {
+			size_t step = (length >> 3) << 2;
+			a = (json_hash_read32(p) << 32) | json_hash_read32(p + step);
+			b = (json_hash_read32(p + length - 4) << 32) | json_hash_read32(p + length - 4 - step);
+		} else if (length > 0) {
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = length;
+		if (i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = json_hash_mix(json_hash_read64(p) ^ secret[1], json_hash_read64(p + 8) ^ seed);
+				see1 = json_hash_mix(json_hash_read64(p + 16) ^ secret[2], json_hash_read64(p + 24) ^ see1);
+				see2 = json_hash_mix(json_hash_read64(p + 32) ^ secret[3], json_hash_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = json_hash_mix(json_hash_read64(p) ^ secret[1], json_hash_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = json_hash_read64(p + i - 16);
+		b = json_hash_read64(p + i - 8);
+	}
+	a ^= secret[1];
+	b ^= seed;
+	json_hash_multiply(&a, &b);
+	return json_hash_mix(a ^ secret[0] ^ length, b ^ secret[1]);
+}
+#endif // CSON_HASH_FNV1A
+
+static inline uint64_t json_key_hash(const json_string_t *const string) {
+	return string->hash ? string->hash : json_hash_bytes(json_string_data(string), string->length);
+}
+
+uint64_t json_string_hash(json_string_t *string) {
+	if (!string) return 0;
+	if (!string->hash) string->hash = json_hash_bytes(json_string_data(string), string->length);
+	return string->hash;
+}
+
+// The low bits of the hash pick the first group, the top 7 are the control byte.
+static inline uint8_t json_object_h2(uint64_t hash) {
+	return hash >> 57;
+}
+
+// The index stays at most 7/8 full so every probe ends at an empty slot.
+static inline size_t json_object_max_load(size_t capacity) {
+	return capacity - capacity / 8;
+}
+
+static inline size_t json_object_index_bytes(size_t capacity) {
+	size_t ctrl_bytes = (capacity + CSON_SIMD_GROUP_WIDTH + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+	return ctrl_bytes + capacity * sizeof(uint32_t);
+}
+
+// The first group is mirrored past the end, a probe may load a whole group at any slot.
+static inline void json_object_set_ctrl(json_object_t *const obj, size_t slot, uint8_t ctrl) {
+	obj->ctrl[slot] = ctrl;
+	if (slot < CSON_SIMD_GROUP_WIDTH) obj->ctrl[obj->capacity + slot] = ctrl;
+}
+
+// Slot of `key`, or -1. Groups are visited with a triangular stride, which
+// reaches every group of a power-of-two table once.
+static ssize_t json_object_find_slot(const json_object_t *const obj, const json_string_t *const key, uint64_t hash) {
+	size_t mask = obj->capacity - 1;
+	size_t pos = hash & mask;
+	uint8_t h2 = json_object_h2(hash);
+	for (size_t stride = CSON_SIMD_GROUP_WIDTH; ; stride += CSON_SIMD_GROUP_WIDTH) {
+		const uint8_t *group = obj->ctrl + pos;
+		for (uint64_t match = json_simd_group_match(group, h2); match; match &= match - 1) {
+			size_t slot = (pos + (__builtin_ctzll(match) >> CSON_SIMD_GROUP_SHIFT)) & mask;
+			const json_string_t *curr = &obj->buckets[obj->slots[slot]].key;
+			if (obj->ctrl[slot] == h2 && curr->hash == hash && json_string_equal(key, curr)) return slot;
+		}
+		if (json_simd_group_match_empty(group)) return -1;
+		pos = (pos + stride) & mask;
+	}
+}
+
+// First empty or deleted slot on the probe sequence of `hash`.
+static size_t json_object_find_free(const json_object_t *const obj, uint64_t hash) {
+	size_t mask = obj->capacity - 1;
+	size_t pos = hash & mask;
+	for (size_t stride = CSON_SIMD_GROUP_WIDTH; ; stride += CSON_SIMD_GROUP_WIDTH) {
+		uint64_t match = json_simd_group_match_free(obj->ctrl + pos);
+		if (match) return (pos + (__builtin_ctzll(match) >> CSON_SIMD_GROUP_SHIFT)) & mask;
+		pos = (pos + stride) & mask;
+	}
+}
+
+// Small objects have no index, their keys are compared length and (when the key
+// already carries one) hash first. The lookup key is not hashed just for this.
+static ssize_t json_object_find_linear(const json_object_t *const obj, const json_string_t *const key) {
+	for (ssize_t i = 0; i < obj->count; ++i) {
+		const json_string_t *curr = &obj->buckets[i].key;
+		if (curr->length != key->length || (key->hash && curr->hash != key->hash)) continue;
+		// Interned keys match on the pointer without touching the bytes.
+		const char *data = json_string_data(curr);
+		if (data == json_string_data(key) || memcmp(data, json_string_data(key), key->length) == 0) return i;
+	}
+	return -1;
+}
+
+// Member holding `key`, or -1.
+static ssize_t json_object_find(const json_object_t *const obj, const json_string_t *const key) {
+	if (!obj->ctrl) return json_object_find_linear(obj, key);
+	ssize_t slot = json_object_find_slot(obj, key, json_key_hash(key));
+	return slot < 0 ? -1 : (ssize_t)obj->slots[slot];
+}
+
+// Smallest index capacity that holds `count` members.
+static size_t json_object_index_capacity(size_t count) {
+	size_t capacity = CSON_SIMD_GROUP_WIDTH * 2;
+	while (json_object_max_load(capacity) < count) capacity *= 2;
+	return capacity;
+}
+
+// Builds a fresh index of `capacity` slots over the members, which also drops every tombstone.
+static int32_t json_object_index_build(json_object_t *const obj, size_t capacity) {
+	if (capacity > UINT32_MAX) return CSON_ERR_MAX_SIZE_REACHED;
+	size_t bytes = json_object_index_bytes(capacity);
+	uint8_t *ctrl = json_allocator_malloc(obj->allocator, bytes);
+	if (!ctrl) {
+		json_error("Failed to allocate object index with %zu slot(s)", capacity);
+		return CSON_ERR_ALLOC;
+	}
+	if (obj->ctrl) json_allocator_free(obj->allocator, obj->ctrl, json_object_index_bytes(obj->capacity));
+	memset(ctrl, CSON_SIMD_CTRL_EMPTY, capacity + CSON_SIMD_GROUP_WIDTH);
+	obj->ctrl = ctrl;
+	obj->slots = (uint32_t *)(ctrl + bytes - capacity * sizeof(uint32_t));
+	obj->capacity = capacity;
+	for (ssize_t i = 0; i < obj->count; ++i) {
+		uint64_t hash = json_key_hash(&obj->buckets[i].key);
+		size_t slot = json_object_find_free(obj, hash);
+		json_object_set_ctrl(obj, slot, json_object_h2(hash));
+		obj->slots[slot] = i;
+	}
+	obj->growth_left = json_object_max_load(capacity) - obj->count;
+	return 0;
 }
 
-int32_t json_object_init(json_object_t *obj, size_t size) {
+// Stores `key` and `value` as a new member, with the key's hash cached so it is
+// never computed again. CSON_ERR_ILLEGAL_OPERATION when the key is already there.
+static int32_t json_object_insert(json_object_t *const obj, const json_string_t *const key, const json_value_t *const value) {
+	uint64_t hash = json_key_hash(key);
+	if (obj->ctrl ? json_object_find_slot(obj, key, hash) >= 0 : json_object_find_linear(obj, key) >= 0) {
+		json_trace("Found duplicate key \"%.*s\"", (int)key->length, json_string_data(key));
+		return CSON_ERR_ILLEGAL_OPERATION;
+	}
+	int res = 0;
+	if (obj->count >= obj->size) {
+		res = json_object_rehash(obj, obj->size * 2);
+		if (res) {
+			json_error("Failed to rehash object due to error %d", res);
+			return res;
+		}
+	}
+	if (!obj->ctrl && obj->count >= CSON_OBJECT_SMALL_SIZE) {
+		// Outgrew the linear search, index every member so far.
+		res = json_object_index_build(obj, json_object_index_capacity(obj->count + 1));
+		if (res) return res;
+	} else if (obj->ctrl && !obj->growth_left) {
+		// Mostly tombstones: rebuilding at the same size is enough to make room.
+		size_t capacity = (size_t)obj->count < json_object_max_load(obj->capacity) / 2 ? obj->capacity : obj->capacity * 2;
+		res = json_object_index_build(obj, capacity);
+		if (res) return res;
+	}
+	if (obj->ctrl) {
+		size_t slot = json_object_find_free(obj, hash);
+		if (obj->ctrl[slot] == CSON_SIMD_CTRL_EMPTY) obj->growth_left--;
+		json_object_set_ctrl(obj, slot, json_object_h2(hash));
+		obj->slots[slot] = obj->count;
+	}
+	json_bucket_t *bucket = &obj->buckets[obj->count++];
+	*bucket = (json_bucket_t){
+		.key = *key,
+		.value = *value
+	};
+	bucket->key.hash = hash;
+	return 0;
+}
+
+int32_t json_object_init(json_object_t *obj, size_t size, const json_allocator_t *allocator) {
 	if (!obj) return CSON_ERR_NULL_PTR;
 	if (size <= 0) return CSON_ERR_INVALID_ARGUMENT;
-	obj->buckets = debug_calloc(size, sizeof(json_bucket_t));
+	*obj = (json_object_t){
+		.allocator = json_allocator_resolve(allocator)
+	};
+	obj->buckets = json_allocator_malloc(obj->allocator, size * sizeof(json_bucket_t));
 	if (!obj->buckets) {
-		fprintf(stderr, LOG_STRING"Failed to allocate memory for buckets\n", __FILE__, __LINE__);
+		json_error("Failed to allocate memory for buckets");
 		return CSON_ERR_ALLOC;
 	}
-	obj->keys = debug_malloc(size * sizeof(json_string_t));
-	if (!obj->keys) {
-		fprintf(stderr, LOG_STRING"Failed to allocate memory for keys\n", __FILE__, __LINE__);
-		debug_free(obj->buckets);
-		return CSON_ERR_ALLOC;
+	// Objects sized for more than a few members get their index up front.
+	if (size > CSON_OBJECT_SMALL_SIZE) {
+		int res = json_object_index_build(obj, json_object_index_capacity(size));
+		if (res) {
+			json_allocator_free(obj->allocator, obj->buckets, size * sizeof(json_bucket_t));
+			obj->buckets = NULL;
+			return res;
+		}
 	}
-	obj->count = 0;
 	obj->size = size;
-	obj->keys->length = 0;
-	obj->keys->size = size;
 	return 0;
 }
 
-int32_t json_array_init(json_array_t *array, size_t size) {
+int32_t json_array_init(json_array_t *array, size_t size, const json_allocator_t *allocator) {
 	if (!array) return CSON_ERR_NULL_PTR;
 	if (size <= 0) return CSON_ERR_INVALID_ARGUMENT;
-	array->objects = debug_calloc(size, sizeof(json_value_t));
+	array->allocator = json_allocator_resolve(allocator);
+	array->objects = json_allocator_malloc(array->allocator, size * sizeof(json_value_t));
 	if (!array->objects) {
-		fprintf(stderr, LOG_STRING"Failed to allocate memory for array\n", __FILE__, __LINE__);
+		json_error("Failed to allocate memory for array");
 		return CSON_ERR_ALLOC;
 	}
+	memset(array->objects, 0, size * sizeof(json_value_t));
 	array->length = 0;
 	array->size = size;
 	return 0;
 }
 
-int32_t json_string_copy(json_string_t *restrict string, const json_string_t *const restrict original) {
+// Stores buf[0, length) inline, `length` is at most CSON_STRING_INLINE_CAPACITY and
+// buf must not point into `str`.
+static inline void json_string_store_inline(json_string_t *str, const char *const buf, ssize_t length) {
+	*str = json_string_empty();
+	char *data = json_string_data(str);
+	if (length) memcpy(data, buf, length);
+	data[length] = '\0';
+	str->length = length;
+}
+
+// Moves an inline string into a heap buffer of `size` bytes.
+static int32_t json_string_spill(json_string_t *str, ssize_t size, const json_allocator_t *allocator) {
+	char *buf = json_allocator_malloc(allocator, size * sizeof(char));
+	if (!buf) {
+		json_error("Failed to move string with length %zd to the heap", str->length);
+		return CSON_ERR_ALLOC;
+	}
+	memcpy(buf, json_string_data(str), str->length + 1);
+	str->buf = buf;
+	str->size = size;
+	return 0;
+}
+
+int32_t json_string_copy(json_string_t *restrict string, const json_string_t *const restrict original, const json_allocator_t *allocator) {
 	if (!string || !original) return CSON_ERR_NULL_PTR;
-	printf("Copying string with length %lld and size %lld\n", original->length, original->size);
-	json_string_printf(original);
-	printf("\n");
-	string->size = original->size > 0 ? original->size : 8;
-	if (original->size == original->length) string->size++;
-	string->buf = debug_malloc(string->size * sizeof(char));
+	const char *data = json_string_data(original);
+	json_trace("Copying string \"%.*s\" with length %zd and size %zd", (int)original->length, data, original->length, original->size);
+	ssize_t length = original->length > 0 ? original->length : 0;
+	if (length <= CSON_STRING_INLINE_CAPACITY) {
+		json_string_store_inline(string, data, length);
+		string->hash = original->hash;
+		return 0;
+	}
+	string->size = original->size > original->length ? original->size : original->length + 1;
+	string->buf = json_allocator_malloc(allocator, string->size * sizeof(char));
 	if (!string->buf) {
-		fprintf(stderr, LOG_STRING"Failed to copy \"%s\" with length %lld and size %lld byte(s)\n", __FILE__, __LINE__, original->buf, original->length, original->size * sizeof(char));
+		json_error("Failed to copy \"%.*s\" with length %zd and size %zu byte(s)", (int)original->length, data, original->length, original->size * sizeof(char));
 		string->size = 0;
 		return CSON_ERR_ALLOC;
 	}
-	ssize_t length = original->length > 0 ? original->length : 0;
-	memcpy(string->buf, original->buf, length);
+	memcpy(string->buf, data, length);
 	string->buf[length] = '\0';
-	printf("Result: \"%s\"\n", string->buf);
+	json_trace("Result: \"%.*s\"", (int)string->length, string->buf);
 	string->length = length;
+	string->hash = original->hash;
 	return 0;
 }
 
-int32_t json_value_copy(json_value_t *restrict copy, const json_value_t *const restrict original) {
+// Deep copy of original whose storage comes from allocator.
+int32_t json_value_copy(json_value_t *restrict copy, const json_value_t *const restrict original, const json_allocator_t *allocator) {
 	if (!copy || !original) return CSON_ERR_NULL_PTR;
-	printf("Copying value\n");
-	json_value_printf(original, 0, true);
-	printf("\n");
+	json_trace("Copying value");
+	json_trace_dump(json_value_printf(original, 0, true), printf("\n"));
 	int res = 0;
 	copy->value_type = original->value_type;
 	switch (original->value_type) {
 		case JSON_OBJECT_TYPE_OBJECT: {
-			json_object_t *obj = debug_malloc(sizeof(json_object_t));
-			*obj = (json_object_t){};
+			json_object_t *obj = json_allocator_malloc(allocator, sizeof(json_object_t));
+			if (!obj) return CSON_ERR_ALLOC;
+			*obj = (json_object_t){
+				.allocator = allocator
+			};
 			json_object_copy(obj, original->object);
 			copy->object = obj;
 		} break;
 		case JSON_OBJECT_TYPE_ARRAY: {
-			json_array_t *array = debug_malloc(sizeof(json_array_t));
-			*array = (json_array_t){};
+			json_array_t *array = json_allocator_malloc(allocator, sizeof(json_array_t));
+			if (!array) return CSON_ERR_ALLOC;
+			*array = (json_array_t){
+				.allocator = allocator
+			};
 			json_array_copy(array, original->array);
 			copy->array = array;
 		} break;
 		case JSON_OBJECT_TYPE_STRING: {
-			res = json_string_copy(&(copy->string), &(original->string));
+			json_string_t view = json_value_string(original);
+			json_string_t string;
+			res = json_string_copy(&string, &view, allocator);
+			if (!res) res = json_value_set_string(copy, &string, allocator);
 			if (res) {
-				fprintf(stderr, LOG_STRING"Freeing copied string \'%s\" due to error %d\n", __FILE__, __LINE__, original->string.buf, res);
-				json_string_free(&(copy->string));
+				json_error("Freeing copied string \'%.*s\" due to error %d", (int)view.length, view.buf, res);
+				json_string_free(&string, allocator);
 				copy->value_type = __JSON_OBJECT_TYPE_MAX;
 			}
 		} break;
@@ -104,7 +431,8 @@ int32_t json_value_copy(json_value_t *restrict copy, const json_value_t *const r
 			copy->boolean = original->boolean;
 		} break;
 		case JSON_OBJECT_TYPE_NUMBER: {
-			copy->number = original->number;
+			copy->num_type = original->num_type;
+			copy->u64 = original->u64;
 		} break;
 		case JSON_OBJECT_TYPE_NULL: {
 			copy->value_type = JSON_OBJECT_TYPE_NULL;
@@ -117,233 +445,78 @@ int32_t json_value_copy(json_value_t *restrict copy, const json_value_t *const r
 	return res;
 }
 
-int32_t json_object_append_key(json_object_t *const obj, const json_string_t *const key, bool copy) {
-	if (!obj || !obj->buckets || !obj->keys || !key) return CSON_ERR_NULL_PTR;
-	if (obj->count >= obj->size) {
-		ssize_t nsz = obj->size * 2;
-		if (nsz < 0 || (nsz * ((ssize_t)sizeof(json_string_t)) < 0)) return CSON_ERR_MAX_SIZE_REACHED;
-		json_string_t *tmp = debug_realloc(obj->keys, nsz * sizeof(json_string_t));
-		if (!tmp) {
-			fprintf(stderr, LOG_STRING"Failed to append key \"%s\" due to error %d\n", __FILE__, __LINE__, key->buf, CSON_ERR_ALLOC);
-			return CSON_ERR_ALLOC;
-		}
-		obj->keys = tmp;
-		obj->size = nsz;
-	}
-	if (copy) {
-		int res = json_string_copy(&obj->keys[obj->count], key);
-		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to append key \"%s\" due to error %d\n", __FILE__, __LINE__, key->buf, res);
-			return res;
-		}
-	} else {
-		obj->keys[obj->count] = *key;
-	}
-	printf("appended key:\n");
-	json_string_printf(&obj->keys[obj->count]);
-	printf("\n");
-	obj->count++;
-	return 0;
-}
-
 int32_t json_object_find_value(json_object_t *const obj, const json_string_t *const key, json_value_t *value) {
-	if (!obj || !obj->buckets || !obj->keys || !key || !key->buf || !value) return CSON_ERR_NULL_PTR;
-	int res = 0;
-	size_t j = json_key_hash(obj->size, key);
-	printf("j: %lld\n", j);
-	json_bucket_t *curr = &obj->buckets[j], *next = obj->buckets[j].next;
-	if (curr->key.buf && strcmp(key->buf, curr->key.buf) == 0) {
-		printf("Found object with key \"%s\"\n", key->buf);
-		*value = curr->value;
-		return 0;
-	}
-	while (next) {
-		if (next->key.buf && strcmp(key->buf, next->key.buf) == 0) {
-			printf("Found object with key \"%s\"\n", key->buf);
-			*value = curr->value;
-			return 0;
-		}
-		printf("curr: 0x%p, next: 0x%p\n", (void*)curr, (void*)next);
-		curr = next;
-		next = next->next;
-	}
-	return CSON_ERR_NOT_FOUND;
+	if (!obj || !obj->buckets || !key || !json_string_data(key) || !value) return CSON_ERR_NULL_PTR;
+	ssize_t index = json_object_find(obj, key);
+	if (index < 0) return CSON_ERR_NOT_FOUND;
+	json_trace("Found object with key \"%.*s\"", (int)key->length, json_string_data(key));
+	*value = obj->buckets[index].value;
+	return 0;
 }
 
 int32_t json_object_delete_key(json_object_t *const obj, const json_string_t *const key, json_value_t *value) {
-	if (!obj || !obj->buckets || !obj->keys || !key || !key->buf) return CSON_ERR_NULL_PTR;
-	if (obj->count < 0) return CSON_ERR_NOT_FOUND; 
-	int res = 0;
-	size_t j = json_key_hash(obj->size, key);
-	printf("j: %lld\n", j);
-	json_bucket_t *curr = &obj->buckets[j], *next = obj->buckets[j].next;
-	if (curr->key.buf && strcmp(key->buf, curr->key.buf) == 0) {
-		printf("Found object with key \"%s\"\n", key->buf);
-		for (ssize_t i = 0; i < obj->count; ++i) {
-			if (strcmp(key->buf, obj->keys[i].buf) == 0) {
-				json_string_free(&obj->keys[i]);
-				obj->keys[i] = obj->keys[obj->count - 1];
-				break;
-			}
-		}
-		if (value) {
-			*value = curr->value;
-			curr->value = (json_value_t){};
-		}
-		else {
-			json_value_free(&curr->value);
-		}
-		json_string_free(&curr->key);
-		curr = curr->next;
-		obj->count--;
-		return 0;
-	}
-	while (next) {
-		if (next->key.buf && strcmp(key->buf, next->key.buf) == 0) {
-			printf("Found object with key \"%s\"\n", key->buf);
-			for (ssize_t i = 0; i < obj->count; ++i) {
-				if (strcmp(key->buf, obj->keys[i].buf) == 0) {
-					json_string_free(&obj->keys[i]);
-					obj->keys[i] = obj->keys[obj->count - 1];
-					break;
-				}
-			}
-			json_string_free(&next->key);
-			if (value) {
-				*value = curr->value;
-				curr->value = (json_value_t){};
-			}
-			else {
-				json_value_free(&curr->value);
-			}
-			next->value = (json_value_t){};
-			curr->next = next->next;
-			obj->count--;
-			return 0;
-		}
-		printf("curr: 0x%p, next: 0x%p\n", (void*)curr, (void*)next);
-		curr = next;
-		next = next->next;
-	}
-	return CSON_ERR_NOT_FOUND;
+	if (!obj || !obj->buckets || !key || !json_string_data(key)) return CSON_ERR_NULL_PTR;
+	size_t index;
+	if (obj->ctrl) {
+		ssize_t slot = json_object_find_slot(obj, key, json_key_hash(key));
+		if (slot < 0) return CSON_ERR_NOT_FOUND;
+		index = obj->slots[slot];
+		json_object_set_ctrl(obj, slot, CSON_SIMD_CTRL_DELETED);
+	} else {
+		ssize_t found = json_object_find_linear(obj, key);
+		if (found < 0) return CSON_ERR_NOT_FOUND;
+		index = found;
+	}
+	json_trace("Found object with key \"%.*s\"", (int)key->length, json_string_data(key));
+	json_bucket_t *bucket = &obj->buckets[index];
+	if (value) *value = bucket->value;
+	else json_value_free(&bucket->value, obj->allocator);
+	json_string_free(&bucket->key, obj->allocator);
+	// The last member fills the hole, like the key list always did.
+	size_t last = obj->count - 1;
+	if (index != last && obj->ctrl) {
+		ssize_t moved = json_object_find_slot(obj, &obj->buckets[last].key, json_key_hash(&obj->buckets[last].key));
+		assert(moved >= 0);
+		obj->slots[moved] = index;
+	}
+	if (index != last) *bucket = obj->buckets[last];
+	obj->buckets[last] = (json_bucket_t){};
+	obj->count--;
+	return 0;
 }
 
 int32_t json_object_append_value(json_object_t *const obj, const json_string_t *const key, const json_value_t *const value) {
-	if (!obj || !obj->buckets || !obj->keys || !key || !key->buf || !value) return CSON_ERR_NULL_PTR;
-	int res = 0;
-	size_t j = json_key_hash(obj->size, key);
-	json_bucket_t *curr = &obj->buckets[j], *next = obj->buckets[j].next;
-	if (!curr->key.buf) {
-		goto assign;
-	}
-	if (curr->key.buf && strcmp(key->buf, curr->key.buf) == 0) {
-		printf("Found duplicate key \"%s\"\n", key->buf);
-		return CSON_ERR_ILLEGAL_OPERATION;
-	}
-	
-	while (next) {
-		if (next->key.buf && strcmp(key->buf, next->key.buf) == 0) {
-			printf("Found duplicate key \"%s\"\n", key->buf);
-			return CSON_ERR_ILLEGAL_OPERATION;
-		}
-		printf("curr: 0x%p, next: 0x%p\n", (void*)curr, (void*)next);
-		curr = next;
-		next = next->next;
-	}
-	assign:
-	curr->next = debug_malloc(sizeof(json_bucket_t));
-	if (!curr->next) {
-		return CSON_ERR_ALLOC;
-	}
-	*curr->next = (json_bucket_t){};
-	curr = curr->next;
-	if (obj->count >= obj->size) {
-		res = json_object_rehash(obj, obj->size * 2);
-		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to rehash object due to error %d\n", __FILE__, __LINE__, res);
-			return res;
-		}
-	}
+	if (!obj || !obj->buckets || !key || !json_string_data(key) || !value) return CSON_ERR_NULL_PTR;
 	json_value_t value_copy = {
 		.value_type = __JSON_OBJECT_TYPE_MAX
 	};
-	res = json_value_copy(&value_copy, value);
+	int res = json_value_copy(&value_copy, value, obj->allocator);
 	if (res) {
-		fprintf(stderr, LOG_STRING"Failed to append object due to error %d\n", __FILE__, __LINE__, res);
+		json_error("Failed to append object due to error %d", res);
 		return res;
 	}
-	curr->value = value_copy;
-	curr->next = NULL;
-	res = json_string_copy(&curr->key, key);
+	json_string_t key_copy = {};
+	res = json_string_copy(&key_copy, key, obj->allocator);
 	if (res) {
-		json_value_free(&value_copy);
-		fprintf(stderr, LOG_STRING"Failed to append object due to error %d\n", __FILE__, __LINE__, res);
+		json_value_free(&value_copy, obj->allocator);
+		json_error("Failed to append object due to error %d", res);
 		return res;
 	}
-	res = json_object_append_key(obj, key, true);
+	res = json_object_insert(obj, &key_copy, &value_copy);
 	if (res) {
-		json_value_free(&value_copy);
-		fprintf(stderr, LOG_STRING"Failed to append object due to error %d\n", __FILE__, __LINE__, res);
+		json_value_free(&value_copy, obj->allocator);
+		json_string_free(&key_copy, obj->allocator);
+		if (res != CSON_ERR_ILLEGAL_OPERATION) json_error("Failed to append object due to error %d", res);
+		return res;
 	}
-	return res;
+	return 0;
 }
 
+// Takes over both `key` and `value`, a borrowed key stays a view into the input.
 int32_t json_object_move_value(json_object_t *const obj, const json_string_t *const key, json_value_t *const value) {
-	if (!obj || !obj->buckets || !obj->keys || !key || !key->buf || !value) return CSON_ERR_NULL_PTR;
-	int res = 0;
-	ssize_t j = json_key_hash(obj->size, key);
-	assert(j >= 0);
-	printf("j: %lld\n", j);
-	json_bucket_t *curr = &obj->buckets[j], *next = obj->buckets[j].next;
-	if (!curr->key.buf) {
-		goto assign;
-	}
-	if (curr->key.buf && strncmp(key->buf, curr->key.buf, max(key->length, curr->key.length)) == 0) {
-		printf("Found duplicate key \"%s\"\n", key->buf);
-		return CSON_ERR_ILLEGAL_OPERATION;
-	}
-	while (next) {
-		if (next->key.buf && strncmp(key->buf, next->key.buf, max(key->length, next->key.length)) == 0) {
-			printf("Found duplicate key \"%s\"\n", key->buf);
-			return CSON_ERR_ILLEGAL_OPERATION;
-		}
-		printf("curr: 0x%p, next: 0x%p\n", (void*)curr, (void*)next);
-		curr = next;
-		next = next->next;
-	}
-	curr->next = debug_malloc(sizeof(json_bucket_t));
-	if (!curr->next) {
-		return CSON_ERR_ALLOC;
-	}
-	*curr->next = (json_bucket_t){};
-	curr = curr->next;
-	assign:
-	if (obj->count >= obj->size) {
-		printf("Rehashing object\n");
-		res = json_object_rehash(obj, obj->size * 2);
-		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to rehash object due to error %d\n", __FILE__, __LINE__, res);
-			return res;
-		}
-	}
-	curr->value = *value;
-	// printf("curr->value:\n");
-	// json_value_printf(&obj->buckets[j].value, 0, true);
-	// printf("\n");
-	curr->next = NULL;
-	res = json_string_copy(&curr->key, key);
-	if (res) {
-		fprintf(stderr, LOG_STRING"Failed to append object due to error %d\n", __FILE__, __LINE__, res);
-		return res;
-	}
-	res = json_object_append_key(obj, key, false);
-	if (res) {
-		fprintf(stderr, LOG_STRING"Failed to append object due to error %d\n", __FILE__, __LINE__, res);
-		return res;
-	}
-	// printf("Move result:\n");
-	// json_object_printf(obj,0,true);
-	// printf("\n");
+	if (!obj || !obj->buckets || !key || !json_string_data(key) || !value) return CSON_ERR_NULL_PTR;
+	int res = json_object_insert(obj, key, value);
+	if (res && res != CSON_ERR_ILLEGAL_OPERATION) json_error("Failed to append object due to error %d", res);
 	return res;
 }
 
@@ -352,16 +525,16 @@ int32_t json_array_append_value(json_array_t *arr, const json_value_t *const val
 	if (arr->length >= arr->size) {
 		int res = json_array_resize(arr, arr->size * 2);
 		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to append value to array with length %lld and size %lld byte(s) due to error %d\n", __FILE__, __LINE__, arr->length, arr->size * sizeof(json_value_t), res);
+			json_error("Failed to append value to array with length %lld and size %lld byte(s) due to error %d", arr->length, arr->size * sizeof(json_value_t), res);
 			return res;
 		}
 	}
 	json_value_t val_copy = {
 		.value_type = __JSON_OBJECT_TYPE_MAX
 	};
-	int res = json_value_copy(&val_copy, val);
+	int res = json_value_copy(&val_copy, val, arr->allocator);
 	if (res) {
-		fprintf(stderr, LOG_STRING"Failed to append value to array with length %lld and size %lld byte(s) due to error %d\n", __FILE__, __LINE__, arr->length, arr->size * sizeof(json_value_t), res);
+		json_error("Failed to append value to array with length %lld and size %lld byte(s) due to error %d", arr->length, arr->size * sizeof(json_value_t), res);
 		return res;
 	}
 	arr->objects[arr->length++] = val_copy;
@@ -373,7 +546,7 @@ int32_t json_array_move_value(json_array_t *arr, const json_value_t *const val)
 	if (arr->length >= arr->size) {
 		int res = json_array_resize(arr, arr->size * 2);
 		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to append value to array with length %lld and size %lld byte(s) due to error %d\n", __FILE__, __LINE__, arr->length, arr->size * sizeof(json_value_t), res);
+			json_error("Failed to append value to array with length %lld and size %lld byte(s) due to error %d", arr->length, arr->size * sizeof(json_value_t), res);
 			return res;
 		}
 	}
@@ -383,19 +556,20 @@ int32_t json_array_move_value(json_array_t *arr, const json_value_t *const val)
 
 int32_t json_string_cmp(const json_string_t *const str1, const json_string_t *const str2, int *res) {
 	if (!str1 || !str2 || !res) return CSON_ERR_NULL_PTR;
-	if (str1 == str2 || str1->buf == str2->buf) {
+	const char *data1 = json_string_data(str1), *data2 = json_string_data(str2);
+	if (str1 == str2 || data1 == data2) {
 		*res = 0;
 		return 0;
 	}
-	if (str1->buf && !str2->buf) {
+	if (data1 && !data2) {
 		*res = 1;
 		return 0;
 	}
-	if (!str1->buf && str2->buf) {
+	if (!data1 && data2) {
 		*res = -1;
 		return 0;
 	}
-	int cmp = strncmp(str1->buf, str2->buf, max(str1->length, str2->length));
+	int cmp = memcmp(data1, data2, str1->length < str2->length ? str1->length : str2->length);
 	if (cmp) {
 		*res = cmp;
 		return 0;
@@ -406,79 +580,50 @@ int32_t json_string_cmp(const json_string_t *const str1, const json_string_t *co
 
 int32_t json_string_cmp_str(const json_string_t *const str, const char *const buf, int *res) {
 	if (!str || !res) return CSON_ERR_NULL_PTR;
-	if (str->buf == buf) {
+	const char *data = json_string_data(str);
+	if (data == buf) {
 		*res = 0;
 		return 0;
 	}
-	if (str->buf && !buf) {
+	if (data && !buf) {
 		*res = 1;
 		return 0;
 	}
-	if (!str->buf && buf) {
+	if (!data && buf) {
 		*res = -1;
 		return 0;
 	}
-	*res = strcmp(str->buf, buf);
+	// Borrowed strings are not NUL-terminated, compare the first `length` bytes only.
+	*res = strncmp(data, buf, str->length);
+	if (!*res && buf[strnlen(buf, str->length)] != '\0') *res = -1;
 	return 0;
 }
 
 int32_t json_object_cmp(const json_object_t *const obj1, const json_object_t *const obj2, int *res) {
-	if (!obj1 || !obj2) return CSON_ERR_NULL_PTR;
+	if (!obj1 || !obj2 || !res) return CSON_ERR_NULL_PTR;
 	*res = 0;
 	if (obj1->count != obj2->count) {
 		*res = 1;
 		return 0;
 	}
-	if (obj1->count == 0) {
-		*res = 0;
-		return 0;
-	}
+	if (obj1->count == 0) return 0;
 	if (obj1->count < 0) return CSON_ERR_INVALID_ARGUMENT;
-	if (obj1->buckets && !obj2->buckets) { 
-		*res = 1;
-		return 0;
-	}
-	if (!obj1->buckets && obj2->buckets) {
-		*res = 1;
-		return 0;
-	} 
-	if (obj1->keys && !obj2->keys) {
-		*res = 1;
+	if (!obj1->buckets || !obj2->buckets) {
+		*res = obj1->buckets != obj2->buckets;
 		return 0;
 	}
-	if (!obj1->buckets && obj2->buckets) {
-		*res = 1;
-		return 0;
-	}
-	json_object_t key_map = {};
-	int result = json_object_init(&key_map, obj1->count);
-	if (result) {
-		return result;
-	}
-	json_value_t dummy_value = {
-		.value_type = JSON_OBJECT_TYPE_NULL,
-		.null = (json_null_t){}
-	};
+	// Same number of members and every member of obj1 found with an equal value in obj2.
 	for (ssize_t i = 0; i < obj1->count; ++i) {
-		ssize_t h1 = json_key_hash(obj1->size, &obj1->keys[i]);
-		ssize_t h2 = json_key_hash(obj2->size, &obj2->keys[i]);
-		// try to append the key to the same object. The number of keys in the key 
-		// map will be equal to the count of the objects if all the keys are equal.
-		json_object_append_value(&key_map, &obj1->keys[i], &dummy_value);
-		json_object_append_value(&key_map, &obj2->keys[i], &dummy_value);
-		json_value_t *val1 = &obj1->buckets[h1].value, *val2 = &obj2->buckets[h2].value;
-		result = json_value_cmp(val1, val2, res);
-		if (result) {
-			json_object_free(&key_map);
-			return result;
-		}
-		if (*res) {
-			json_object_free(&key_map);
+		const json_bucket_t *bucket = &obj1->buckets[i];
+		ssize_t index = json_object_find(obj2, &bucket->key);
+		if (index < 0) {
+			*res = 1;
 			return 0;
 		}
+		int result = json_value_cmp(&bucket->value, &obj2->buckets[index].value, res);
+		if (result) return result;
+		if (*res) return 0;
 	}
-	*res = key_map.count != obj1->count;
-	json_object_free(&key_map);
 	return 0;
 }
 
@@ -518,24 +663,26 @@ int32_t json_value_cmp(const json_value_t *const val1, const json_value_t *const
 			if (result) return result;
 		} break;
 		case JSON_OBJECT_TYPE_STRING: {
-			result = json_string_cmp(&val1->string, &val2->string, res);
+			json_string_t str1 = json_value_string(val1);
+			json_string_t str2 = json_value_string(val2);
+			result = json_string_cmp(&str1, &str2, res);
 			if (result) return result;
 		} break;
 		case JSON_OBJECT_TYPE_BOOL: {
 			*res = val1->boolean != val2->boolean;
 		} break;
 		case JSON_OBJECT_TYPE_NUMBER: {
-			*res = val1->number.num_type != val2->number.num_type;
+			*res = val1->num_type != val2->num_type;
 			if (*res) return 0;
-			switch (val1->number.num_type) {
+			switch (val1->num_type) {
 				case JSON_NUMBER_TYPE_F64: {
-					*res = (val1->number.f64 > val2->number.f64) - (val1->number.f64 < val2->number.f64);
+					*res = (val1->f64 > val2->f64) - (val1->f64 < val2->f64);
 				} break;
 				case JSON_NUMBER_TYPE_I64: {
-					*res = (val1->number.i64 > val2->number.i64) - (val1->number.i64 < val2->number.i64);
+					*res = (val1->i64 > val2->i64) - (val1->i64 < val2->i64);
 				} break;
 				case JSON_NUMBER_TYPE_U64: {
-					*res = (val1->number.u64 > val2->number.u64) - (val1->number.u64 < val2->number.u64);
+					*res = (val1->u64 > val2->u64) - (val1->u64 < val2->u64);
 				} break;
 				default:
 					break;
@@ -555,7 +702,7 @@ int32_t json_array_delete_index(json_array_t *arr, const ssize_t index, json_val
 	if (!arr || !arr->objects) return CSON_ERR_NULL_PTR;
 	if (index >= arr->length) return CSON_ERR_NOT_FOUND;
 	if (val) val = &arr->objects[index];
-	else json_value_free(&arr->objects[index]);
+	else json_value_free(&arr->objects[index], arr->allocator);
 	for (size_t i = index + 1; i < arr->length; ++i) {
 		arr->objects[i - 1] = arr->objects[i];
 	}
@@ -568,7 +715,7 @@ int32_t json_array_pop(json_array_t *array, json_value_t *val) {
 	if (val) {
 		*val = array->objects[array->length - 1];
 	} else {
-		json_value_free(&array->objects[array->length - 1]);
+		json_value_free(&array->objects[array->length - 1], array->allocator);
 	} 
 	array->length--;
 	return 0;
@@ -585,7 +732,7 @@ int32_t json_array_delete_value(json_array_t *arr, const json_value_t *const val
 				} break;
 				
 				default:
-					json_value_free(&arr->objects[i]);
+					json_value_free(&arr->objects[i], arr->allocator);
 					break;
 			}
 		}
@@ -599,9 +746,9 @@ int32_t json_array_copy(json_array_t *const restrict array, const json_array_t *
 	if (!array || !original_array || (!original_array->objects && original_array->length)) return CSON_ERR_NULL_PTR;
 	int res = 0;
 	if (!array->objects) {
-		res = json_array_init(array, original_array->size > 0 ? original_array->size : 8);
+		res = json_array_init(array, original_array->size > 0 ? original_array->size : 8, array->allocator);
 		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to copy array with length %lld and size %lld byte(s) due to error %d\n", __FILE__, __LINE__, original_array->length, original_array->size * sizeof(json_value_t), res);
+			json_error("Failed to copy array with length %lld and size %lld byte(s) due to error %d", original_array->length, original_array->size * sizeof(json_value_t), res);
 			return res;
 		}
 	}
@@ -609,10 +756,10 @@ int32_t json_array_copy(json_array_t *const restrict array, const json_array_t *
 		json_value_t val_copy = {
 			.value_type = __JSON_OBJECT_TYPE_MAX
 		};
-		int res = json_value_copy(&val_copy, &original_array->objects[i]);
+		int res = json_value_copy(&val_copy, &original_array->objects[i], array->allocator);
 		if (res) {
 			json_array_free(array);
-			fprintf(stderr, LOG_STRING"Failed to append value to array with length %lld and size %lld byte(s) due to error %d\n", __FILE__, __LINE__, array->length, array->size * sizeof(json_value_t), res);
+			json_error("Failed to append value to array with length %lld and size %lld byte(s) due to error %d", array->length, array->size * sizeof(json_value_t), res);
 			return res;
 		}
 		array->objects[i] = val_copy;
@@ -624,77 +771,304 @@ int32_t json_array_copy(json_array_t *const restrict array, const json_array_t *
 
 int32_t json_object_copy(json_object_t *const copy, const json_object_t *const obj) {
 	if (!copy || !obj) return CSON_ERR_NULL_PTR;
-	ssize_t i;
 	if (!copy->buckets) {
-		int res = json_object_init(copy, obj->size > 0 ? obj->size : 8);
+		int res = json_object_init(copy, obj->size > 0 ? obj->size : 8, copy->allocator);
 		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to copy due to error %d\n", __FILE__, __LINE__, res);
+			json_error("Failed to copy due to error %d", res);
 			return res;
 		}
 	}
-	printf("Copying object at address %p", (void*)obj);
-	for (i = 0; i < obj->count; ++i) {
-		json_string_t *key = &obj->keys[i];
-		ssize_t j = json_key_hash(copy->size, key);
-		assert(j >= 0);
-		json_value_t *curr = &obj->buckets[j].value;
-		printf("Copying value with key: \"%s\"\n", key->buf);
-		json_value_printf(curr, 0, true);
-		printf("\n");
-		int res = json_object_append_value(copy, key, curr);
+	json_trace("Copying object at address %p", (void*)obj);
+	for (ssize_t i = 0; i < obj->count; ++i) {
+		const json_bucket_t *bucket = &obj->buckets[i];
+		json_trace("Copying value with key: \"%.*s\"", (int)bucket->key.length, json_string_data(&bucket->key));
+		json_trace_dump(json_value_printf(&bucket->value, 0, true), printf("\n"));
+		int res = json_object_append_value(copy, &bucket->key, &bucket->value);
 		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to copy value at index %lld\n", __FILE__, __LINE__, j);
+			json_error("Failed to copy value at index %zd", i);
 			json_object_free(copy);
+			return res;
 		}
 	}
 	return 0;
 }
 
-int32_t json_string_append_char(json_string_t *str, const char ch) {
+int32_t json_string_own(json_string_t *str, const json_allocator_t *allocator) {
 	if (!str) return CSON_ERR_NULL_PTR;
-	if (!str->buf) {
-		str->buf = debug_malloc(8 * sizeof(char));
-		if (!str->buf) {
-			return CSON_ERR_ALLOC;
+	if (!json_string_is_borrowed(str)) return 0;
+	if (str->length <= CSON_STRING_INLINE_CAPACITY) {
+		uint64_t hash = str->hash;
+		json_string_store_inline(str, str->buf, str->length);
+		str->hash = hash;
+		return 0;
+	}
+	ssize_t size = str->length + 1 > 8 ? (str->length + 1) * 2 : 8;
+	char *buf = json_allocator_malloc(allocator, size * sizeof(char));
+	if (!buf) {
+		json_error("Failed to copy borrowed string with length %lld", str->length);
+		return CSON_ERR_ALLOC;
+	}
+	memcpy(buf, str->buf, str->length);
+	buf[str->length] = '\0';
+	str->buf = buf;
+	str->size = size;
+	return 0;
+}
+
+bool json_string_equal(const json_string_t *const str1, const json_string_t *const str2) {
+	if (str1->length != str2->length) return false;
+	if (str1->hash && str2->hash && str1->hash != str2->hash) return false;
+	const char *data1 = json_string_data(str1), *data2 = json_string_data(str2);
+	if (data1 == data2) return true;
+	if (!data1 || !data2) return false;
+	return memcmp(data1, data2, str1->length) == 0;
+}
+
+int32_t json_string_append_char(json_string_t *str, const char ch, const json_allocator_t *allocator) {
+	if (!str) return CSON_ERR_NULL_PTR;
+	if (json_string_is_borrowed(str)) {
+		int res = json_string_own(str, allocator);
+		if (res) return res;
+	}
+	if (!str->buf && !json_string_is_inline(str)) *str = json_string_empty();
+	if (json_string_is_inline(str)) {
+		char *data = json_string_data(str);
+		if (str->length < CSON_STRING_INLINE_CAPACITY) {
+			data[str->length++] = ch;
+			data[str->length] = '\0';
+			str->hash = 0;
+			return 0;
 		}
-		str->length = 0;
-		str->size = 8;
+		int res = json_string_spill(str, (CSON_STRING_INLINE_CAPACITY + 1) * 2, allocator);
+		if (res) return res;
 	}
 	if (str->length >= str->size) {
 		ssize_t nsz = str->size * 2;
-		char *tmp = debug_realloc(str->buf, nsz * sizeof(char));
 		if (nsz <= 0) return CSON_ERR_MAX_SIZE_REACHED;
+		char *tmp = json_allocator_realloc(allocator, str->buf, str->size * sizeof(char), nsz * sizeof(char));
 		if (!tmp) return CSON_ERR_ALLOC;
 		str->buf = tmp;
 		str->size = nsz;
 		str->buf[str->size - 1] = '\0';
 	}
 	str->buf[str->length++] = ch;
+	str->hash = 0;
 	return 0;
 }
 
-int32_t json_string_free(json_string_t *string) {
+int32_t json_string_append_buf(json_string_t *str, const char *const buf, ssize_t length, const json_allocator_t *allocator) {
+	if (!str || !buf) return CSON_ERR_NULL_PTR;
+	if (length <= 0) return 0;
+	if (json_string_is_borrowed(str)) {
+		int res = json_string_own(str, allocator);
+		if (res) return res;
+	}
+	if (!str->buf && !json_string_is_inline(str)) *str = json_string_empty();
+	// Reserve for the whole run (and a terminator) at once instead of doubling per character.
+	ssize_t needed = str->length + length + 1;
+	if (json_string_is_inline(str)) {
+		if (needed <= CSON_STRING_INLINE_CAPACITY + 1) {
+			char *data = json_string_data(str);
+			memcpy(data + str->length, buf, length);
+			str->length += length;
+			data[str->length] = '\0';
+			str->hash = 0;
+			return 0;
+		}
+		ssize_t nsz = (CSON_STRING_INLINE_CAPACITY + 1) * 2;
+		int res = json_string_spill(str, needed > nsz ? needed : nsz, allocator);
+		if (res) return res;
+	}
+	if (!str->buf || needed > str->size) {
+		ssize_t nsz = str->size * 2 > needed ? str->size * 2 : needed;
+		if (nsz < 8) nsz = 8;
+		char *tmp = str->buf
+			? json_allocator_realloc(allocator, str->buf, str->size * sizeof(char), nsz * sizeof(char))
+			: json_allocator_malloc(allocator, nsz * sizeof(char));
+		if (!tmp) return CSON_ERR_ALLOC;
+		if (!str->buf) str->length = 0;
+		str->buf = tmp;
+		str->size = nsz;
+	}
+	memcpy(str->buf + str->length, buf, length);
+	str->length += length;
+	str->buf[str->length] = '\0';
+	str->hash = 0;
+	return 0;
+}
+
+static inline bool json_hex4(const char *const p, uint32_t *out) {
+	uint32_t value = 0;
+	for (int32_t i = 0; i < 4; ++i) {
+		char ch = p[i];
+		value <<= 4;
+		if (ch >= '0' && ch <= '9') value |= ch - '0';
+		else if (ch >= 'a' && ch <= 'f') value |= ch - 'a' + 10;
+		else if (ch >= 'A' && ch <= 'F') value |= ch - 'A' + 10;
+		else return false;
+	}
+	*out = value;
+	return true;
+}
+
+static inline size_t json_utf8_encode(uint32_t code_point, char *out) {
+	if (code_point < 0x80) {
+		out[0] = (char)code_point;
+		return 1;
+	}
+	if (code_point < 0x800) {
+		out[0] = (char)(0xC0 | (code_point >> 6));
+		out[1] = (char)(0x80 | (code_point & 0x3F));
+		return 2;
+	}
+	if (code_point < 0x10000) {
+		out[0] = (char)(0xE0 | (code_point >> 12));
+		out[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		out[2] = (char)(0x80 | (code_point & 0x3F));
+		return 3;
+	}
+	out[0] = (char)(0xF0 | (code_point >> 18));
+	out[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+	out[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+	out[3] = (char)(0x80 | (code_point & 0x3F));
+	return 4;
+}
+
+// Decodes the \uXXXX escape (and the low half of a surrogate pair) at p into out.
+static size_t json_unicode_escape(const char *const p, size_t available, char *out, size_t *written) {
+	uint32_t code_point;
+	if (available < 6 || !json_hex4(p + 2, &code_point)) return 0;
+	if (code_point >= 0xD800 && code_point < 0xDC00) {
+		uint32_t low;
+		if (available < 12 || p[6] != '\\' || p[7] != 'u' || !json_hex4(p + 8, &low) || low < 0xDC00 || low >= 0xE000) return 0;
+		*written = json_utf8_encode(0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00), out);
+		return 12;
+	}
+	if (code_point >= 0xDC00 && code_point < 0xE000) return 0;
+	*written = json_utf8_encode(code_point, out);
+	return 6;
+}
+
+int32_t json_string_unescape(const char *const buf, size_t n, char *out, size_t *length, size_t *consumed) {
+	if (!buf || !out || !length || !consumed) return CSON_ERR_NULL_PTR;
+	size_t pointer = 0, written = 0;
+	while (pointer < n) {
+		// Plain runs are found with the SIMD kernel and copied with one memcpy each.
+		size_t run = json_simd_find_string_special(buf + pointer, n - pointer);
+		memcpy(out + written, buf + pointer, run);
+		written += run;
+		pointer += run;
+		if (pointer >= n) break;
+		char ch = buf[pointer];
+		if (ch == '"') {
+			*length = written;
+			*consumed = pointer + 1;
+			return 0;
+		}
+		if (ch != '\\' || pointer + 1 >= n) {
+			json_error("Found invalid character 0x%02x in string at index %zu", (unsigned char)ch, pointer);
+			return CSON_ERR_INVALID_ARGUMENT;
+		}
+		char escaped;
+		switch (buf[pointer + 1]) {
+			case '"': escaped = '"'; break;
+			case '\\': escaped = '\\'; break;
+			case '/': escaped = '/'; break;
+			case 'b': escaped = '\b'; break;
+			case 'f': escaped = '\f'; break;
+			case 'n': escaped = '\n'; break;
+			case 'r': escaped = '\r'; break;
+			case 't': escaped = '\t'; break;
+			case 'u': {
+				size_t decoded = 0;
+				size_t escape_length = json_unicode_escape(buf + pointer, n - pointer, out + written, &decoded);
+				if (!escape_length) {
+					json_error("Invalid unicode escape at index %zu", pointer);
+					return CSON_ERR_INVALID_ARGUMENT;
+				}
+				written += decoded;
+				pointer += escape_length;
+				continue;
+			}
+			default: {
+				json_error("Invalid escape character \\%c", buf[pointer + 1]);
+				return CSON_ERR_INVALID_ARGUMENT;
+			}
+		}
+		out[written++] = escaped;
+		pointer += 2;
+	}
+	json_error("Unterminated string");
+	return CSON_ERR_INVALID_ARGUMENT;
+}
+
+int32_t json_string_free(json_string_t *string, const json_allocator_t *allocator) {
 	if (!string) return CSON_ERR_NULL_PTR;
-	if (string->buf) debug_free(string->buf);
+	if (string->size > 0 && string->buf) json_allocator_free(allocator, string->buf, string->size * sizeof(char));
+	*string = (json_string_t){};
+	return 0;
+}
+
+int32_t json_value_set_string(json_value_t *value, json_string_t *string, const json_allocator_t *allocator) {
+	if (!value || !string) return CSON_ERR_NULL_PTR;
+	const char *data = json_string_data(string);
+	ssize_t length = string->length > 0 ? string->length : 0;
+	if ((size_t)length > UINT32_MAX) {
+		json_error("String value with length %zd exceeds %u byte(s)", length, UINT32_MAX);
+		return CSON_ERR_MAX_SIZE_REACHED;
+	}
+	json_value_t result = {
+		.length = (uint32_t)length,
+		.value_type = JSON_OBJECT_TYPE_STRING
+	};
+	if (length <= CSON_VALUE_INLINE_CAPACITY) {
+		if (length) memcpy(result.small, data, length);
+		result.small[length] = '\0';
+		result.string_tag = (uint8_t)length;
+		json_string_free(string, allocator);
+	} else if (json_string_is_borrowed(string)) {
+		result.buf = string->buf;
+		result.string_tag = CSON_VALUE_STRING_BORROWED;
+	} else {
+		// Inline strings one byte too long for the value move to the heap, owned
+		// buffers give back whatever growth left unused.
+		char *buf = string->buf;
+		if (json_string_is_inline(string)) {
+			buf = json_allocator_malloc(allocator, length + 1);
+			if (!buf) return CSON_ERR_ALLOC;
+			memcpy(buf, data, length);
+		} else if (string->size != length + 1) {
+			buf = json_allocator_realloc(allocator, string->buf, string->size, length + 1);
+			if (!buf) return CSON_ERR_ALLOC;
+		}
+		buf[length] = '\0';
+		result.buf = buf;
+		result.string_tag = CSON_VALUE_STRING_OWNED;
+	}
+	*value = result;
 	*string = (json_string_t){};
 	return 0;
 }
 
-int32_t json_value_free(json_value_t *val) {
+int32_t json_value_free(json_value_t *val, const json_allocator_t *allocator) {
 	if (!val) return CSON_ERR_NULL_PTR;
 	switch (val->value_type) {
 		case JSON_OBJECT_TYPE_OBJECT: {
+			if (!val->object) break;
+			const json_allocator_t *owner = val->object->allocator;
 			json_object_free(val->object);
-			printf("Freeing allocated object pointer\n");
-			debug_free(val->object);
+			json_trace("Freeing allocated object pointer");
+			json_allocator_free(owner, val->object, sizeof(json_object_t));
 		} break;
 		case JSON_OBJECT_TYPE_ARRAY: {
+			if (!val->array) break;
+			const json_allocator_t *owner = val->array->allocator;
 			json_array_free(val->array);
-			printf("Freeing allocated array pointer\n");
-			debug_free(val->array);
+			json_trace("Freeing allocated array pointer");
+			json_allocator_free(owner, val->array, sizeof(json_array_t));
 		} break;
 		case JSON_OBJECT_TYPE_STRING: {
-			json_string_free(&val->string);
+			if (val->string_tag == CSON_VALUE_STRING_OWNED) json_allocator_free(allocator, val->buf, (size_t)val->length + 1);
 		} break;
 		case JSON_OBJECT_TYPE_BOOL:
 		case JSON_OBJECT_TYPE_NUMBER:
@@ -708,48 +1082,19 @@ int32_t json_value_free(json_value_t *val) {
 int32_t json_object_free(json_object_t *obj) {
 	if (!obj) return CSON_ERR_NULL_PTR;
 	if (obj->buckets) {
-		for (ssize_t i = 0, j = 0; i < obj->count && j < obj->size; ++j) {
-			json_bucket_t *curr = &obj->buckets[j];
-			if (!curr->key.buf) continue;
-			printf(LOG_STRING"Freeing object with key %s\n", __FILE__, __LINE__, curr->key.buf);
-			printf("Value:\n");
-			json_value_printf(&curr->value, 0, true);
-			printf("\n");
-			json_value_free(&curr->value);
-			printf(LOG_STRING"Freeing object key ", __FILE__, __LINE__);
-			json_string_printf(&curr->key);
-			printf(" at index %lld\n", i);
-			json_string_free(&curr->key);
-			curr = curr->next;
-			i++;
-			while (curr) {
-				json_bucket_t *prev = curr;
-				printf(LOG_STRING"Freeing object with key %s\n", __FILE__, __LINE__, curr->key.buf);
-				printf("Value:\n");
-				json_value_printf(&curr->value, 0, true);
-				printf("\n");
-				json_value_free(&curr->value);
-				printf(LOG_STRING"Freeing object key ", __FILE__, __LINE__);
-				json_string_printf(&curr->key);
-				printf(" at index %lld\n", i);
-				json_string_free(&curr->key);
-				curr = curr->next;
-				debug_free(prev);
-				i++;
-			}
-		}
-		printf(LOG_STRING"Freeing buckets with count %lld and size %lld byte(s)\n", __FILE__, __LINE__, obj->count, obj->size * sizeof(json_bucket_t));
-		debug_free(obj->buckets);
-	}
-	if (obj->keys) {
-		for (ssize_t j = 0; j < obj->count; ++j) {
-			printf(LOG_STRING"Freeing key ", __FILE__, __LINE__);
-			json_string_printf(&obj->keys[j]);
-			printf(" at index %lld with length %lld and size %lld byte(s)\n", j, obj->keys[j].length, obj->keys[j].size * sizeof(char));
-			debug_free(obj->keys[j].buf);
+		for (ssize_t i = 0; i < obj->count; ++i) {
+			json_bucket_t *bucket = &obj->buckets[i];
+			json_trace("Freeing object with key %.*s", (int)bucket->key.length, json_string_data(&bucket->key));
+			json_trace_dump(json_value_printf(&bucket->value, 0, true), printf("\n"));
+			json_value_free(&bucket->value, obj->allocator);
+			json_string_free(&bucket->key, obj->allocator);
 		}
-		printf(LOG_STRING"Freeing key array with count %lld and size %lld byte(s)\n", __FILE__, __LINE__, obj->count, obj->size * sizeof(json_string_t));
-		debug_free(obj->keys);
+		json_trace("Freeing buckets with count %lld and size %lld byte(s)", obj->count, obj->size * sizeof(json_bucket_t));
+		json_allocator_free(obj->allocator, obj->buckets, obj->size * sizeof(json_bucket_t));
+	}
+	if (obj->ctrl) {
+		json_trace("Freeing object index with %zu slot(s)", obj->capacity);
+		json_allocator_free(obj->allocator, obj->ctrl, json_object_index_bytes(obj->capacity));
 	}
 	*obj = (json_object_t){};
 	return 0;
@@ -759,14 +1104,13 @@ int32_t json_array_free(json_array_t *array) {
 	if (!array) return CSON_ERR_NULL_PTR;
 	for (ssize_t i = 0; i < array->length; ++i) {
 		json_value_t *val = &array->objects[i];
-		debug_printf(LOG_STRING"Freeing value\n", __FILE__, __LINE__);
-		json_value_printf(val, 0, true);
-		printf("\nat index %lld\n", i);
-		json_value_free(val);
+		json_trace("Freeing value at index %lld", i);
+		json_trace_dump(json_value_printf(val, 0, true), printf("\n"));
+		json_value_free(val, array->allocator);
 	}
 	if (array->objects) {
-		printf(LOG_STRING"Freeing object array with length %lld and size %lld byte(s)\n", __FILE__, __LINE__, array->length, array->size * sizeof(json_value_t));
-		debug_free(array->objects);
+		json_trace("Freeing object array with length %lld and size %lld byte(s)", array->length, array->size * sizeof(json_value_t));
+		json_allocator_free(array->allocator, array->objects, array->size * sizeof(json_value_t));
 	}
 	*array = (json_array_t){};
 	return 0;
@@ -776,9 +1120,9 @@ int32_t json_array_resize(json_array_t *array, ssize_t new_size) {
 	if (!array) return CSON_ERR_NULL_PTR;
 	if (new_size <= array->size) return CSON_ERR_INVALID_ARGUMENT;
 	if (new_size * ((ssize_t)sizeof(json_value_t)) < 0) return CSON_ERR_MAX_SIZE_REACHED;
-	json_value_t *tmp = debug_realloc(array->objects, new_size * sizeof(json_value_t));
+	json_value_t *tmp = json_allocator_realloc(array->allocator, array->objects, array->size * sizeof(json_value_t), new_size * sizeof(json_value_t));
 	if (!tmp) {
-		fprintf(stderr, LOG_STRING"Failed to resize array with length %lld and size %lld byte(s) to %lld byte(s)\n", __FILE__, __LINE__, array->length, array->size * sizeof(json_value_t), new_size * sizeof(json_value_t));
+		json_error("Failed to resize array with length %zd and size %zu byte(s) to %zu byte(s)", array->length, array->size * sizeof(json_value_t), new_size * sizeof(json_value_t));
 		return CSON_ERR_ALLOC;
 	}
 	array->objects = tmp;
@@ -789,32 +1133,112 @@ int32_t json_array_resize(json_array_t *array, ssize_t new_size) {
 	return 0;
 }
 
+// Resizes the member storage to `new_size` and rebuilds the index to fit it.
 int32_t json_object_rehash(json_object_t *obj, ssize_t new_size) {
 	if (!obj) return CSON_ERR_NULL_PTR;
 	if (obj->count >= new_size) return CSON_ERR_INVALID_ARGUMENT;
-	json_object_t new_obj;
-	int res = json_object_init(&new_obj, new_size);
+	if (new_size * ((ssize_t)sizeof(json_bucket_t)) < 0) return CSON_ERR_MAX_SIZE_REACHED;
+	json_bucket_t *tmp = json_allocator_realloc(obj->allocator, obj->buckets, obj->size * sizeof(json_bucket_t), new_size * sizeof(json_bucket_t));
+	if (!tmp) {
+		json_error("Failed to resize object with count %zd to %zd member(s)", obj->count, new_size);
+		return CSON_ERR_ALLOC;
+	}
+	obj->buckets = tmp;
+	obj->size = new_size;
+	if (!obj->ctrl) return 0;
+	size_t capacity = json_object_index_capacity(new_size);
+	if (capacity != obj->capacity) return json_object_index_build(obj, capacity);
+	return 0;
+}
+
+int32_t json_array_reserve(json_array_t *array, ssize_t size) {
+	if (!array) return CSON_ERR_NULL_PTR;
+	if (size <= array->size) return 0;
+	return json_array_resize(array, size);
+}
+
+int32_t json_object_reserve(json_object_t *obj, ssize_t size) {
+	if (!obj) return CSON_ERR_NULL_PTR;
+	if (size <= obj->size) return 0;
+	int res = json_object_rehash(obj, size);
 	if (res) return res;
+	// Index up front rather than at the insert that outgrows the linear search.
+	if (!obj->ctrl && size > CSON_OBJECT_SMALL_SIZE) return json_object_index_build(obj, json_object_index_capacity(size));
+	return 0;
+}
+
+int32_t json_array_shrink_to_fit(json_array_t *array, bool recursive) {
+	if (!array) return CSON_ERR_NULL_PTR;
+	if (recursive) {
+		for (ssize_t i = 0; i < array->length; ++i) {
+			int res = json_value_shrink_to_fit(&array->objects[i]);
+			if (res) return res;
+		}
+	}
+	// One slot stays so appending can keep doubling.
+	ssize_t new_size = array->length ? array->length : 1;
+	if (!array->objects || new_size >= array->size) return 0;
+	json_value_t *tmp = json_allocator_realloc(array->allocator, array->objects, array->size * sizeof(json_value_t), new_size * sizeof(json_value_t));
+	if (!tmp) {
+		json_error("Failed to shrink array with length %zd and size %zd", array->length, array->size);
+		return CSON_ERR_ALLOC;
+	}
+	array->objects = tmp;
+	array->size = new_size;
+	return 0;
+}
+
+// Also trims owned keys to their length. Objects left with no more members than
+// the linear search handles lose their index.
+int32_t json_object_shrink_to_fit(json_object_t *obj, bool recursive) {
+	if (!obj) return CSON_ERR_NULL_PTR;
+	if (!obj->buckets) return 0;
 	for (ssize_t i = 0; i < obj->count; ++i) {
-		json_string_t *key = &obj->keys[i]; 
-		ssize_t j = json_key_hash(obj->size, key);
-		if (j < 0) {
-			fprintf(stderr, LOG_STRING"Failed to hash key at index %lld with key %s\n", __FILE__, __LINE__, i, key->buf);
-			json_object_free(&new_obj);
-			return res;
+		json_bucket_t *bucket = &obj->buckets[i];
+		json_string_t *key = &bucket->key;
+		if (key->size > 0 && key->buf && key->size != key->length + 1) {
+			char *buf = json_allocator_realloc(obj->allocator, key->buf, key->size, key->length + 1);
+			if (!buf) return CSON_ERR_ALLOC;
+			key->buf = buf;
+			key->size = key->length + 1;
 		}
-		json_value_t *curr = &obj->buckets[j].value;
-		res = json_object_append_value(&new_obj, key, curr);
-		if (res) {
-			fprintf(stderr, LOG_STRING"Failed to append key at index %lld with key %s\n", __FILE__, __LINE__, i, key->buf);
-			json_object_free(&new_obj);
-			return res;
+		if (recursive) {
+			int res = json_value_shrink_to_fit(&bucket->value);
+			if (res) return res;
 		}
 	}
-	*obj = new_obj;
+	ssize_t new_size = obj->count ? obj->count : 1;
+	if (new_size < obj->size) {
+		json_bucket_t *tmp = json_allocator_realloc(obj->allocator, obj->buckets, obj->size * sizeof(json_bucket_t), new_size * sizeof(json_bucket_t));
+		if (!tmp) {
+			json_error("Failed to shrink object with count %zd and size %zd", obj->count, obj->size);
+			return CSON_ERR_ALLOC;
+		}
+		obj->buckets = tmp;
+		obj->size = new_size;
+	}
+	if (!obj->ctrl) return 0;
+	if (obj->count <= CSON_OBJECT_SMALL_SIZE) {
+		json_allocator_free(obj->allocator, obj->ctrl, json_object_index_bytes(obj->capacity));
+		obj->ctrl = NULL;
+		obj->slots = NULL;
+		obj->capacity = obj->growth_left = 0;
+		return 0;
+	}
+	size_t capacity = json_object_index_capacity(obj->count);
+	if (capacity < obj->capacity) return json_object_index_build(obj, capacity);
 	return 0;
 }
 
+int32_t json_value_shrink_to_fit(json_value_t *value) {
+	if (!value) return CSON_ERR_NULL_PTR;
+	switch (value->value_type) {
+		case JSON_OBJECT_TYPE_OBJECT: return value->object ? json_object_shrink_to_fit(value->object, true) : 0;
+		case JSON_OBJECT_TYPE_ARRAY: return value->array ? json_array_shrink_to_fit(value->array, true) : 0;
+		default: return 0;
+	}
+}
+
 int32_t json_array_printf(const json_array_t *const arr, uint64_t indent) {
 	if (!arr || (!arr->objects && arr->length)) return CSON_ERR_NULL_PTR;
 	printf("[");
@@ -839,10 +1263,11 @@ int32_t json_array_printf(const json_array_t *const arr, uint64_t indent) {
 
 int32_t json_string_printf(const json_string_t *const str) {
 	if (!str) return CSON_ERR_NULL_PTR;
-	if (str->buf) {
+	const char *data = json_string_data(str);
+	if (data) {
 		printf("\"");
 		for (ssize_t i = 0; i < str->length; ++i) {
-			char c = str->buf[i];
+			char c = data[i];
 			switch (c) {
 				case '\'': {
 					printf("\\\'");
@@ -882,21 +1307,22 @@ int32_t json_value_printf(const json_value_t *const val, uint64_t indent, bool s
 			json_array_printf(val->array, indent);
 		} break;
 		case JSON_OBJECT_TYPE_STRING: {
-			json_string_printf(&val->string);
+			json_string_t string = json_value_string(val);
+			json_string_printf(&string);
 		} break;
 		case JSON_OBJECT_TYPE_BOOL: {
 			printf("%s", val->boolean ? "true" : "false");
 		} break;
 		case JSON_OBJECT_TYPE_NUMBER: {
-			switch (val->number.num_type) {
+			switch (val->num_type) {
 				case JSON_NUMBER_TYPE_I64: {
-					printf("%lld", val->number.i64);
+					printf("%lld", val->i64);
 				} break;
 				case JSON_NUMBER_TYPE_U64: {
-					printf("%llu", val->number.u64);
+					printf("%llu", val->u64);
 				} break;
 				case JSON_NUMBER_TYPE_F64: {
-					printf("%f", val->number.f64);
+					printf("%f", val->f64);
 				} break;
 				default: {
 					return CSON_ERR_INVALID_ARGUMENT;
@@ -914,55 +1340,17 @@ int32_t json_value_printf(const json_value_t *const val, uint64_t indent, bool s
 }
 
 int32_t json_object_printf(const json_object_t *const obj, uint64_t indent, bool start) {
-	if (!obj || ((!obj->buckets || !obj->keys) && obj->count)) return CSON_ERR_NULL_PTR;
+	if (!obj || (!obj->buckets && obj->count)) return CSON_ERR_NULL_PTR;
 	printf("{");
 	if (obj->count > 0) {
 		printf("\n");
-		ssize_t i, j = 0;
-		for (i = 0; i < obj->count - 1; ++i) {
-			j = json_key_hash(obj->size, &obj->keys[i]);
-			if (j < 0) {
-				fprintf(stderr, "Cannot hash key \"%s\"\n", obj->keys[i].buf);
-				continue;
-			}
-			json_bucket_t *curr = &obj->buckets[j];
-			// printf("curr:\nkey:\n");
-			// json_string_printf(&curr->key);
-			// printf("\nvalue:\n");
-			// json_value_printf(&curr->value, 0, true);
-			// printf("\n");
-			while (curr->key.buf && strncmp(curr->key.buf, obj->keys[i].buf, max(curr->key.length, obj->keys[i].length))) {
-				curr = curr->next;
-			}
-			if (!curr) {
-				printf("Cannot find key \"%s\"\n", obj->keys[i].buf);
-				continue;
-			}
+		for (ssize_t i = 0; i < obj->count; ++i) {
+			const json_bucket_t *bucket = &obj->buckets[i];
 			for (uint64_t l = 0; l < indent + 1; ++l) printf("\t");
-			json_string_printf(&curr->key);
+			json_string_printf(&bucket->key);
 			printf(": ");
-			json_value_t *val = &curr->value;
-			json_value_printf(val, indent + 1, false);
-			printf(",\n");
-		}
-		for (uint64_t l = 0; l < indent + 1; ++l) printf("\t");
-		j = json_key_hash(obj->size, &obj->keys[i]);
-		if (j < 0) {
-			printf("Cannot hash key \"%s\"\n", obj->keys[i].buf);
-		} else {
-			json_bucket_t *curr = &obj->buckets[j];
-			while (curr->key.buf && strncmp(curr->key.buf, obj->keys[i].buf, max(curr->key.length, obj->keys[i].length))) {
-				curr = curr->next;
-			} 
-			if (!curr) {
-				printf("Cannot find key \"%s\"\n", obj->keys[i].buf);
-			} else {
-				json_string_printf(&curr->key);
-				printf(": ");
-				json_value_t *val = &curr->value;
-				json_value_printf(val, indent + 1, false);
-				printf("\n");
-			}
+			json_value_printf(&bucket->value, indent + 1, false);
+			printf(i < obj->count - 1 ? ",\n" : "\n");
 		}
 		for (uint64_t l = 0; l < indent; ++l) printf("\t");
 	}
@@ -1,36 +1,35 @@
 
 #include "../include/cson_common.h"
 
-static int64_t ptr_count;
 #ifdef __CSON_DEBUG
-#define debug_printf(...) printf(__VA_ARGS__)
+static int64_t ptr_count;
 void debug_free(void *ptr) { \
 	ptr_count--;
 	assert(ptr_count >= 0);
-	printf("Pointer count: %lld\n", ptr_count);
-	printf("Freeing address 0x%p\n", ptr); \
+	json_trace("Pointer count: %lld", ptr_count);
+	json_trace("Freeing address 0x%p", ptr); \
 	free(ptr); \
 }
 void *debug_malloc(size_t size) {
-	printf("Allocating pointer with size %llu byte(s)\n", size);
+	json_trace("Allocating pointer with size %llu byte(s)", size);
 	void *ptr = malloc(size);
 	ptr_count++;
-	printf("Resulting ptr: 0x%p\n", ptr);
-	printf("Pointer count: %lld\n", ptr_count);
+	json_trace("Resulting ptr: 0x%p", ptr);
+	json_trace("Pointer count: %lld", ptr_count);
 	return ptr;
 }
 void *debug_calloc(const size_t num_elements, const size_t element_size) {
-	printf("Allocating pointer with length %lld and size %llu byte(s)\n", num_elements, num_elements * element_size);
+	json_trace("Allocating pointer with length %lld and size %llu byte(s)", num_elements, num_elements * element_size);
 	void *ptr = calloc(num_elements, element_size);
 	ptr_count++;
-	printf("Pointer count: %lld\n", ptr_count);
-	printf("Resulting ptr: 0x%p\n", ptr);
+	json_trace("Pointer count: %lld", ptr_count);
+	json_trace("Resulting ptr: 0x%p", ptr);
 	return ptr;
 }
 void *debug_realloc(void *ptr, size_t size) {
-	printf("Reallocating pointer at address %p with size %llu byte(s)\n", ptr, size);
+	json_trace("Reallocating pointer at address %p with size %llu byte(s)", ptr, size);
 	void *new_ptr = realloc(ptr, size);
-	printf("Resulting ptr: 0x%p\n", new_ptr);
+	json_trace("Resulting ptr: 0x%p", new_ptr);
 	return new_ptr;
 }
 #endif // __CSON_DEBUG
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "../include/cson_intern.h"
+
+#define CSON_INTERN_MIN_CAPACITY 64
+
+int32_t json_intern_init(json_intern_table_t *table, const json_allocator_t *allocator) {
+	if (!table) return CSON_ERR_NULL_PTR;
+	*table = (json_intern_table_t){
+		.allocator = json_allocator_resolve(allocator)
+	};
+	return 0;
+}
+
+// Copies buf[0, length) and a NUL behind the newest chunk's used bytes, a string
+// that does not fit starts a new chunk (of its own when it is larger than one).
+static char *json_intern_store(json_intern_table_t *table, const char *const buf, size_t length) {
+	json_intern_chunk_t *head = table->chunks;
+	if (!head || head->size - head->used < length + 1) {
+		size_t size = length + 1 > CSON_INTERN_CHUNK_SIZE ? length + 1 : CSON_INTERN_CHUNK_SIZE;
+		json_intern_chunk_t *chunk = json_allocator_malloc(table->allocator, sizeof(json_intern_chunk_t) + size);
+		if (!chunk) {
+			json_error("Failed to allocate intern chunk with size %zu byte(s)", size);
+			return NULL;
+		}
+		chunk->used = 0;
+		chunk->size = size;
+		chunk->next = head;
+		table->chunks = head = chunk;
+	}
+	char *out = head->data + head->used;
+	memcpy(out, buf, length);
+	out[length] = '\0';
+	head->used += length + 1;
+	return out;
+}
+
+static int32_t json_intern_grow(json_intern_table_t *table) {
+	size_t capacity = table->capacity ? table->capacity * 2 : CSON_INTERN_MIN_CAPACITY;
+	json_string_t *strings = json_allocator_malloc(table->allocator, capacity * sizeof(json_string_t));
+	if (!strings) {
+		json_error("Failed to grow intern table to %zu slot(s)", capacity);
+		return CSON_ERR_ALLOC;
+	}
+	memset(strings, 0, capacity * sizeof(json_string_t));
+	size_t mask = capacity - 1;
+	for (size_t i = 0; i < table->capacity; ++i) {
+		if (!table->strings[i].buf) continue;
+		size_t slot = table->strings[i].hash & mask;
+		while (strings[slot].buf) slot = (slot + 1) & mask;
+		strings[slot] = table->strings[i];
+	}
+	if (table->capacity) json_allocator_free(table->allocator, table->strings, table->capacity * sizeof(json_string_t));
+	table->strings = strings;
+	table->capacity = capacity;
+	return 0;
+}
+
+int32_t json_intern(json_intern_table_t *table, const char *const buf, size_t length, json_string_t *interned) {
+	if (!table || !interned || (!buf && length)) return CSON_ERR_NULL_PTR;
+	if ((table->count + 1) * 2 > table->capacity) {
+		int res = json_intern_grow(table);
+		if (res) return res;
+	}
+	uint64_t hash = json_hash_bytes(buf, length);
+	size_t mask = table->capacity - 1;
+	size_t slot = hash & mask;
+	for (; table->strings[slot].buf; slot = (slot + 1) & mask) {
+		const json_string_t *curr = &table->strings[slot];
+		if (curr->hash == hash && (size_t)curr->length == length && memcmp(curr->buf, buf, length) == 0) {
+			*interned = *curr;
+			return 0;
+		}
+	}
+	char *copy = json_intern_store(table, buf, length);
+	if (!copy) return CSON_ERR_ALLOC;
+	table->strings[slot] = (json_string_t){
+		.buf = copy,
+		.length = length,
+		.hash = hash
+	};
+	table->count++;
+	*interned = table->strings[slot];
+	return 0;
+}
+
+int32_t json_intern_free(json_intern_table_t *table) {
+	if (!table) return CSON_ERR_NULL_PTR;
+	json_intern_chunk_t *curr = table->chunks;
+	while (curr) {
+		json_intern_chunk_t *next = curr->next;
+		json_allocator_free(table->allocator, curr, sizeof(json_intern_chunk_t) + curr->size);
+		curr = next;
+	}
+	if (table->capacity) {
+		json_trace("Freeing intern table with %zu key(s)", table->count);
+		json_allocator_free(table->allocator, table->strings, table->capacity * sizeof(json_string_t));
+	}
+	*table = (json_intern_table_t){
+		.allocator = table->allocator
+	};
+	return 0;
+}
@@ -0,0 +1,632 @@
+#include "../include/cson_ondemand.h"
+
+static inline size_t json_doc_skip_whitespace(const json_cursor_t *const cursor, size_t pointer) {
+	return pointer + json_simd_skip_whitespace(cursor->input + pointer, cursor->length - pointer);
+}
+
+// Finds the end (one past the closing quote) of the string opening at input[pointer].
+static int32_t json_doc_skip_string(const json_cursor_t *const cursor, size_t pointer, size_t *end, bool *escaped) {
+	const char *const input = cursor->input;
+	pointer++;
+	if (escaped) *escaped = false;
+	while (pointer < cursor->length) {
+		pointer += json_simd_find_string_special(input + pointer, cursor->length - pointer);
+		if (pointer >= cursor->length) break;
+		if (input[pointer] == '"') {
+			*end = pointer + 1;
+			return 0;
+		}
+		if (input[pointer] != '\\') {
+			json_error("Found invalid character 0x%02x in string at index %zu", (unsigned char)input[pointer], pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		if (escaped) *escaped = true;
+		pointer += 2;
+	}
+	json_error("Unterminated string");
+	return CSON_PARSER_STATE_INVALID_CHARACTER;
+}
+
+// Finds the end of the container opening at input[pointer] by counting brackets.
+// Candidates come 64 bytes at a time from the SIMD classifier, strings are jumped
+// over whole so brackets inside them do not count.
+static int32_t json_doc_skip_container(const json_cursor_t *const cursor, size_t pointer, size_t *end) {
+	const char *const input = cursor->input;
+	size_t depth = 0;
+	json_simd_block_t masks;
+	while (pointer < cursor->length) {
+		size_t available = cursor->length - pointer;
+		if (available >= CSON_SIMD_BLOCK_SIZE) {
+			json_simd_classify_block(input + pointer, &masks);
+		} else {
+			char tail[CSON_SIMD_BLOCK_SIZE];
+			memset(tail, ' ', CSON_SIMD_BLOCK_SIZE);
+			memcpy(tail, input + pointer, available);
+			json_simd_classify_block(tail, &masks);
+		}
+		uint64_t bits = masks.structural | masks.quote;
+		size_t next = pointer + CSON_SIMD_BLOCK_SIZE;
+		while (bits) {
+			size_t position = pointer + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			switch (input[position]) {
+				case '{':
+				case '[': depth++; break;
+				case '}':
+				case ']': {
+					if (--depth == 0) {
+						*end = position + 1;
+						return 0;
+					}
+				} break;
+				case '"': {
+					int res = json_doc_skip_string(cursor, position, &next, NULL);
+					if (res) return res;
+					// The rest of this block may sit inside the string, classify again from its end.
+					bits = 0;
+				} break;
+				default: break;
+			}
+		}
+		pointer = next;
+	}
+	json_error("Unterminated container");
+	return CSON_PARSER_STATE_INVALID_CHARACTER;
+}
+
+static int32_t json_doc_skip_value(const json_cursor_t *const cursor, size_t pointer, size_t *end) {
+	if (pointer >= cursor->length) return CSON_PARSER_STATE_INVALID_CHARACTER;
+	switch (cursor->input[pointer]) {
+		case '{':
+		case '[': return json_doc_skip_container(cursor, pointer, end);
+		case '"': return json_doc_skip_string(cursor, pointer, end, NULL);
+		default: {
+			// Numbers and literals run up to the next delimiter.
+			size_t p = pointer;
+			while (p < cursor->length) {
+				char ch = cursor->input[p];
+				if (ch == ',' || ch == '}' || ch == ']' || ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') break;
+				p++;
+			}
+			if (p == pointer) {
+				json_error("Found illegal character \'%c\' at index %zu", cursor->input[pointer], pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
+			}
+			*end = p;
+		} break;
+	}
+	return 0;
+}
+
+// Compares the key opening at input[pointer] with `key` and reports where it ends.
+static int32_t json_doc_match_key(const json_cursor_t *const cursor, size_t pointer, const char *const key, size_t key_length, size_t *end, bool *match) {
+	bool escaped;
+	int res = json_doc_skip_string(cursor, pointer, end, &escaped);
+	if (res) return res;
+	const char *const raw = cursor->input + pointer + 1;
+	size_t raw_length = *end - pointer - 2;
+	if (!escaped) {
+		*match = raw_length == key_length && memcmp(raw, key, key_length) == 0;
+		return 0;
+	}
+	// Unescaping never grows a string, a shorter raw key cannot match.
+	if (raw_length < key_length) {
+		*match = false;
+		return 0;
+	}
+	char stack_buf[256];
+	char *decoded = raw_length + 1 <= sizeof(stack_buf) ? stack_buf : json_allocator_malloc(&json_default_allocator, raw_length + 1);
+	if (!decoded) return CSON_ERR_ALLOC;
+	size_t length, consumed;
+	res = json_string_unescape(raw, raw_length + 1, decoded, &length, &consumed);
+	if (!res) *match = length == key_length && memcmp(decoded, key, key_length) == 0;
+	if (decoded != stack_buf) json_allocator_free(&json_default_allocator, decoded, raw_length + 1);
+	return res == CSON_ERR_INVALID_ARGUMENT ? CSON_PARSER_STATE_INVALID_CHARACTER : res;
+}
+
+int32_t json_doc_init(json_cursor_t *cursor, const char *const data, size_t len) {
+	if (!cursor || !data) return CSON_ERR_NULL_PTR;
+	*cursor = (json_cursor_t){
+		.input = data,
+		.length = len
+	};
+	cursor->pointer = json_doc_skip_whitespace(cursor, 0);
+	if (cursor->pointer >= len) {
+		json_error("Empty document");
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	return 0;
+}
+
+json_object_type_t json_doc_type(const json_cursor_t *const cursor) {
+	if (!cursor || cursor->pointer >= cursor->length) return __JSON_OBJECT_TYPE_MAX;
+	switch (cursor->input[cursor->pointer]) {
+		case '{': return JSON_OBJECT_TYPE_OBJECT;
+		case '[': return JSON_OBJECT_TYPE_ARRAY;
+		case '"': return JSON_OBJECT_TYPE_STRING;
+		case 't':
+		case 'f': return JSON_OBJECT_TYPE_BOOL;
+		case 'n': return JSON_OBJECT_TYPE_NULL;
+		case '-':
+		case '0' ... '9': return JSON_OBJECT_TYPE_NUMBER;
+		default: return __JSON_OBJECT_TYPE_MAX;
+	}
+}
+
+int32_t json_doc_get_field(const json_cursor_t *const object, const char *const key, json_cursor_t *field) {
+	if (!object || !key || !field) return CSON_ERR_NULL_PTR;
+	if (json_doc_type(object) != JSON_OBJECT_TYPE_OBJECT) return CSON_ERR_ILLEGAL_OPERATION;
+	size_t key_length = strlen(key);
+	size_t pointer = json_doc_skip_whitespace(object, object->pointer + 1);
+	if (pointer < object->length && object->input[pointer] == '}') return CSON_ERR_NOT_FOUND;
+	while (pointer < object->length) {
+		if (object->input[pointer] != '"') {
+			json_error("Expected key at index %zu", pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		bool match;
+		int res = json_doc_match_key(object, pointer, key, key_length, &pointer, &match);
+		if (res) return res;
+		pointer = json_doc_skip_whitespace(object, pointer);
+		if (pointer >= object->length || object->input[pointer] != ':') {
+			json_error("Expected \':\' at index %zu", pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		pointer = json_doc_skip_whitespace(object, pointer + 1);
+		if (match) {
+			*field = *object;
+			field->pointer = pointer;
+			return 0;
+		}
+		res = json_doc_skip_value(object, pointer, &pointer);
+		if (res) return res;
+		pointer = json_doc_skip_whitespace(object, pointer);
+		if (pointer >= object->length) break;
+		if (object->input[pointer] == '}') return CSON_ERR_NOT_FOUND;
+		if (object->input[pointer] != ',') {
+			json_error("Expected \',\' or \'}\' at index %zu", pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		pointer = json_doc_skip_whitespace(object, pointer + 1);
+	}
+	json_error("Unexpected end of input");
+	return CSON_PARSER_STATE_INVALID_CHARACTER;
+}
+
+int32_t json_doc_get_index(const json_cursor_t *const array, size_t index, json_cursor_t *element) {
+	if (!array || !element) return CSON_ERR_NULL_PTR;
+	if (json_doc_type(array) != JSON_OBJECT_TYPE_ARRAY) return CSON_ERR_ILLEGAL_OPERATION;
+	size_t pointer = json_doc_skip_whitespace(array, array->pointer + 1);
+	if (pointer < array->length && array->input[pointer] == ']') return CSON_ERR_NOT_FOUND;
+	for (size_t i = 0; pointer < array->length; ++i) {
+		if (i == index) {
+			*element = *array;
+			element->pointer = pointer;
+			return 0;
+		}
+		int res = json_doc_skip_value(array, pointer, &pointer);
+		if (res) return res;
+		pointer = json_doc_skip_whitespace(array, pointer);
+		if (pointer >= array->length) break;
+		if (array->input[pointer] == ']') return CSON_ERR_NOT_FOUND;
+		if (array->input[pointer] != ',') {
+			json_error("Expected \',\' or \']\' at index %zu", pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		pointer = json_doc_skip_whitespace(array, pointer + 1);
+	}
+	json_error("Unexpected end of input");
+	return CSON_PARSER_STATE_INVALID_CHARACTER;
+}
+
+// Reads the string opening at input[pointer], see json_doc_get_string, and reports where it ends.
+static int32_t json_doc_string_at(const json_cursor_t *const cursor, size_t pointer, json_string_t *string, const json_allocator_t *allocator, size_t *end) {
+	bool escaped;
+	int res = json_doc_skip_string(cursor, pointer, end, &escaped);
+	if (res) return res;
+	const char *const raw = cursor->input + pointer + 1;
+	size_t raw_length = *end - pointer - 2;
+	if (!escaped) {
+		*string = (json_string_t){
+			.buf = (char *)raw,
+			.length = raw_length
+		};
+		return 0;
+	}
+	char *buf = json_allocator_malloc(allocator, raw_length + 1);
+	if (!buf) return CSON_ERR_ALLOC;
+	size_t length, consumed;
+	res = json_string_unescape(raw, raw_length + 1, buf, &length, &consumed);
+	if (res) {
+		json_allocator_free(allocator, buf, raw_length + 1);
+		return res == CSON_ERR_INVALID_ARGUMENT ? CSON_PARSER_STATE_INVALID_CHARACTER : res;
+	}
+	buf[length] = '\0';
+	*string = (json_string_t){
+		.buf = buf,
+		.length = length,
+		.size = raw_length + 1
+	};
+	return 0;
+}
+
+int32_t json_doc_get_string(const json_cursor_t *const cursor, json_string_t *string, const json_allocator_t *allocator) {
+	if (!cursor || !string) return CSON_ERR_NULL_PTR;
+	if (json_doc_type(cursor) != JSON_OBJECT_TYPE_STRING) return CSON_ERR_ILLEGAL_OPERATION;
+	size_t end;
+	return json_doc_string_at(cursor, cursor->pointer, string, allocator, &end);
+}
+
+int32_t json_doc_get_number(const json_cursor_t *const cursor, json_number_t *number) {
+	if (!cursor || !number) return CSON_ERR_NULL_PTR;
+	if (json_doc_type(cursor) != JSON_OBJECT_TYPE_NUMBER) return CSON_ERR_ILLEGAL_OPERATION;
+	size_t consumed;
+	int res = json_number_scan(cursor->input + cursor->pointer, cursor->length - cursor->pointer, number, &consumed);
+	return res == CSON_ERR_INVALID_ARGUMENT ? CSON_PARSER_STATE_INVALID_CHARACTER : res;
+}
+
+int32_t json_doc_get_bool(const json_cursor_t *const cursor, bool *boolean) {
+	if (!cursor || !boolean) return CSON_ERR_NULL_PTR;
+	const char *const p = cursor->input + cursor->pointer;
+	size_t available = cursor->length - cursor->pointer;
+	if (available >= 4 && memcmp(p, "true", 4) == 0) *boolean = true;
+	else if (available >= 5 && memcmp(p, "false", 5) == 0) *boolean = false;
+	else return CSON_ERR_ILLEGAL_OPERATION;
+	return 0;
+}
+
+int32_t json_doc_get_value(const json_cursor_t *const cursor, json_parser_t *const parser, json_value_t *value) {
+	if (!cursor || !parser || !value) return CSON_ERR_NULL_PTR;
+	size_t end;
+	int res = json_doc_skip_value(cursor, cursor->pointer, &end);
+	if (res) {
+		json_parser_free(parser);
+		return res;
+	}
+	return json_parse_buffer(parser, value, cursor->input + cursor->pointer, end - cursor->pointer);
+}
+
+// Length of the reference token at the start of `token`, up to the next '/'.
+static inline size_t json_pointer_token_length(const char *const token) {
+	return strcspn(token, "/");
+}
+
+// Compares a reference token with a key, ~0 and ~1 standing for '~' and '/'.
+static bool json_pointer_token_equal(const char *const token, size_t token_length, const json_string_t *const key) {
+	size_t i = 0, j = 0;
+	while (i < token_length && j < (size_t)key->length) {
+		char ch = token[i++];
+		if (ch == '~') ch = token[i++] == '0' ? '~' : '/';
+		if (ch != json_string_data(key)[j++]) return false;
+	}
+	return i == token_length && j == (size_t)key->length;
+}
+
+// Array indices are decimal without leading zeros, SIZE_MAX for a token that selects no element.
+static size_t json_pointer_token_index(const char *const token, size_t token_length) {
+	if (token_length == 0 || (token[0] == '0' && token_length > 1)) return SIZE_MAX;
+	size_t index = 0;
+	for (size_t i = 0; i < token_length; ++i) {
+		if (token[i] < '0' || token[i] > '9') return SIZE_MAX;
+		size_t digit = token[i] - '0';
+		if (index > (SIZE_MAX - 1 - digit) / 10) return SIZE_MAX;
+		index = index * 10 + digit;
+	}
+	return index;
+}
+
+static int32_t json_pointer_validate(const char *const path) {
+	if (*path && *path != '/') {
+		json_error("JSON Pointer \"%s\" does not start with \'/\'", path);
+		return CSON_ERR_INVALID_ARGUMENT;
+	}
+	for (const char *p = path; *p; ++p) {
+		if (*p == '~' && p[1] != '0' && p[1] != '1') {
+			json_error("JSON Pointer \"%s\" has an invalid escape", path);
+			return CSON_ERR_INVALID_ARGUMENT;
+		}
+	}
+	return 0;
+}
+
+// Builds all of input[pointer, end) into `value` with the parser's allocator and options.
+static int32_t json_project_materialize(const json_cursor_t *const doc, json_parser_t *const parser, size_t pointer, size_t end, json_value_t *value) {
+	const char *const p = doc->input + pointer;
+	size_t length = end - pointer;
+	int res = 0;
+	switch (*p) {
+		case '{':
+		case '[': {
+			json_parser_t sub;
+			res = json_parser_init_with_allocator(&sub, parser->scratch_allocator);
+			if (res) return res;
+			sub.allocator = parser->allocator;
+			sub.options = parser->options;
+			sub.intern = parser->intern;
+			return json_parse_buffer(&sub, value, p, length);
+		}
+		case '"': {
+			json_string_t string;
+			res = json_doc_string_at(doc, pointer, &string, parser->allocator, &end);
+			if (res) return res;
+			if (!(parser->options & CSON_PARSER_OPTION_ZERO_COPY)) res = json_string_own(&string, parser->allocator);
+			if (!res) res = json_value_set_string(value, &string, parser->allocator);
+			if (res) {
+				json_string_free(&string, parser->allocator);
+				return res;
+			}
+		} break;
+		case 't':
+		case 'f':
+		case 'n': {
+			if (length == 4 && memcmp(p, "true", 4) == 0) *value = (json_value_t){ .value_type = JSON_OBJECT_TYPE_BOOL, .boolean = true };
+			else if (length == 5 && memcmp(p, "false", 5) == 0) *value = (json_value_t){ .value_type = JSON_OBJECT_TYPE_BOOL, .boolean = false };
+			else if (length == 4 && memcmp(p, "null", 4) == 0) *value = (json_value_t){ .value_type = JSON_OBJECT_TYPE_NULL };
+			else {
+				json_error("Found invalid literal at index %zu", pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
+			}
+		} break;
+		default: {
+			json_number_t number;
+			size_t consumed;
+			res = json_number_scan(p, length, &number, &consumed);
+			if (res || consumed != length) {
+				json_error("Found invalid number at index %zu", pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
+			}
+			*value = (json_value_t){
+				.u64 = number.u64,
+				.num_type = number.num_type,
+				.value_type = JSON_OBJECT_TYPE_NUMBER
+			};
+		} break;
+	}
+	return 0;
+}
+
+static int32_t json_project_value(const json_cursor_t *const doc, json_parser_t *const parser, size_t pointer, const char **paths, size_t count, json_value_t *value, bool *kept, size_t *end);
+
+// Walks the object at input[pointer], keeping the members some pointer in `paths` continues into.
+static int32_t json_project_object(const json_cursor_t *const doc, json_parser_t *const parser, size_t pointer, const char **paths, size_t count, json_value_t *value, size_t *end) {
+	const json_allocator_t *allocator = parser->allocator;
+	json_object_t *object = json_allocator_malloc(allocator, sizeof(json_object_t));
+	if (!object) return CSON_ERR_ALLOC;
+	int res = json_object_init(object, 8, allocator);
+	if (res) {
+		json_allocator_free(allocator, object, sizeof(json_object_t));
+		return res;
+	}
+	*value = (json_value_t){
+		.value_type = JSON_OBJECT_TYPE_OBJECT,
+		.object = object
+	};
+	const char **next = json_allocator_malloc(parser->scratch_allocator, count * sizeof(const char *));
+	if (!next) {
+		json_value_free(value, allocator);
+		return CSON_ERR_ALLOC;
+	}
+	pointer = json_doc_skip_whitespace(doc, pointer + 1);
+	if (pointer < doc->length && doc->input[pointer] == '}') {
+		*end = pointer + 1;
+		goto done;
+	}
+	while (pointer < doc->length) {
+		if (doc->input[pointer] != '"') {
+			json_error("Expected key at index %zu", pointer);
+			res = CSON_PARSER_STATE_INVALID_CHARACTER;
+			goto done;
+		}
+		json_string_t key;
+		res = json_doc_string_at(doc, pointer, &key, allocator, &pointer);
+		if (res) goto done;
+		pointer = json_doc_skip_whitespace(doc, pointer);
+		if (pointer >= doc->length || doc->input[pointer] != ':') {
+			json_string_free(&key, allocator);
+			json_error("Expected \':\' at index %zu", pointer);
+			res = CSON_PARSER_STATE_INVALID_CHARACTER;
+			goto done;
+		}
+		pointer = json_doc_skip_whitespace(doc, pointer + 1);
+		size_t n = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const char *token = paths[i] + 1;
+			size_t token_length = json_pointer_token_length(token);
+			if (json_pointer_token_equal(token, token_length, &key)) next[n++] = token + token_length;
+		}
+		if (n) {
+			json_value_t child;
+			bool kept;
+			res = json_project_value(doc, parser, pointer, next, n, &child, &kept, &pointer);
+			if (!res && kept) {
+				if (parser->intern) {
+					json_string_t interned;
+					res = json_intern(parser->intern, json_string_data(&key), key.length, &interned);
+					if (!res) {
+						json_string_free(&key, allocator);
+						key = interned;
+					}
+				} else if (!(parser->options & CSON_PARSER_OPTION_ZERO_COPY)) res = json_string_own(&key, allocator);
+				if (!res) res = json_object_move_value(object, &key, &child);
+				// The object takes over the key.
+				if (!res) key = (json_string_t){};
+				else json_value_free(&child, allocator);
+				// Like the tree parser, the first of several equal keys wins.
+				if (res == CSON_ERR_ILLEGAL_OPERATION) res = 0;
+			}
+		} else {
+			res = json_doc_skip_value(doc, pointer, &pointer);
+		}
+		json_string_free(&key, allocator);
+		if (res) goto done;
+		pointer = json_doc_skip_whitespace(doc, pointer);
+		if (pointer >= doc->length) break;
+		if (doc->input[pointer] == '}') {
+			*end = pointer + 1;
+			goto done;
+		}
+		if (doc->input[pointer] != ',') {
+			json_error("Expected \',\' or \'}\' at index %zu", pointer);
+			res = CSON_PARSER_STATE_INVALID_CHARACTER;
+			goto done;
+		}
+		pointer = json_doc_skip_whitespace(doc, pointer + 1);
+	}
+	json_error("Unexpected end of input");
+	res = CSON_PARSER_STATE_INVALID_CHARACTER;
+	done:
+	json_allocator_free(parser->scratch_allocator, next, count * sizeof(const char *));
+	if (!res && (parser->options & CSON_PARSER_OPTION_EXACT_SIZE)) res = json_object_shrink_to_fit(object, false);
+	if (res) json_value_free(value, allocator);
+	return res;
+}
+
+// Walks the array at input[pointer], keeping the elements some pointer in `paths`
+// continues into. Elements before a kept one become nulls so indices stay put,
+// the ones after the last kept element are dropped.
+static int32_t json_project_array(const json_cursor_t *const doc, json_parser_t *const parser, size_t pointer, const char **paths, size_t count, json_value_t *value, size_t *end) {
+	const json_allocator_t *allocator = parser->allocator;
+	json_array_t *array = json_allocator_malloc(allocator, sizeof(json_array_t));
+	if (!array) return CSON_ERR_ALLOC;
+	int res = json_array_init(array, 8, allocator);
+	if (res) {
+		json_allocator_free(allocator, array, sizeof(json_array_t));
+		return res;
+	}
+	*value = (json_value_t){
+		.value_type = JSON_OBJECT_TYPE_ARRAY,
+		.array = array
+	};
+	// The index every pointer selects, parsed once, followed by room for the matches.
+	size_t scratch_size = count * (sizeof(size_t) + sizeof(const char *));
+	size_t *indices = json_allocator_malloc(parser->scratch_allocator, scratch_size);
+	if (!indices) {
+		json_value_free(value, allocator);
+		return CSON_ERR_ALLOC;
+	}
+	const char **next = (const char **)(indices + count);
+	for (size_t i = 0; i < count; ++i) {
+		const char *token = paths[i] + 1;
+		indices[i] = json_pointer_token_index(token, json_pointer_token_length(token));
+	}
+	pointer = json_doc_skip_whitespace(doc, pointer + 1);
+	if (pointer < doc->length && doc->input[pointer] == ']') {
+		*end = pointer + 1;
+		goto done;
+	}
+	for (size_t index = 0; pointer < doc->length; ++index) {
+		size_t n = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (indices[i] == index) next[n++] = paths[i] + 1 + json_pointer_token_length(paths[i] + 1);
+		}
+		if (n) {
+			json_value_t child;
+			bool kept;
+			res = json_project_value(doc, parser, pointer, next, n, &child, &kept, &pointer);
+			if (res) goto done;
+			if (kept) {
+				json_value_t null = {
+					.value_type = JSON_OBJECT_TYPE_NULL
+				};
+				while (!res && (size_t)array->length < index) res = json_array_move_value(array, &null);
+				if (!res) res = json_array_move_value(array, &child);
+				if (res) {
+					json_value_free(&child, allocator);
+					goto done;
+				}
+			}
+		} else {
+			res = json_doc_skip_value(doc, pointer, &pointer);
+			if (res) goto done;
+		}
+		pointer = json_doc_skip_whitespace(doc, pointer);
+		if (pointer >= doc->length) break;
+		if (doc->input[pointer] == ']') {
+			*end = pointer + 1;
+			goto done;
+		}
+		if (doc->input[pointer] != ',') {
+			json_error("Expected \',\' or \']\' at index %zu", pointer);
+			res = CSON_PARSER_STATE_INVALID_CHARACTER;
+			goto done;
+		}
+		pointer = json_doc_skip_whitespace(doc, pointer + 1);
+	}
+	json_error("Unexpected end of input");
+	res = CSON_PARSER_STATE_INVALID_CHARACTER;
+	done:
+	json_allocator_free(parser->scratch_allocator, indices, scratch_size);
+	if (!res && (parser->options & CSON_PARSER_OPTION_EXACT_SIZE)) res = json_array_shrink_to_fit(array, false);
+	if (res) json_value_free(value, allocator);
+	return res;
+}
+
+// Projects the value at input[pointer] onto `paths`, the parts of the pointers
+// that are left to follow. An empty one keeps the whole value. Containers on the
+// way are only kept when some pointer resolved inside them, scalars when selected.
+static int32_t json_project_value(const json_cursor_t *const doc, json_parser_t *const parser, size_t pointer, const char **paths, size_t count, json_value_t *value, bool *kept, size_t *end) {
+	*kept = false;
+	if (pointer >= doc->length) {
+		json_error("Unexpected end of input");
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		if (*paths[i]) continue;
+		int res = json_doc_skip_value(doc, pointer, end);
+		if (res) return res;
+		res = json_project_materialize(doc, parser, pointer, *end, value);
+		*kept = !res;
+		return res;
+	}
+	int res = 0;
+	switch (doc->input[pointer]) {
+		case '{': res = json_project_object(doc, parser, pointer, paths, count, value, end); break;
+		case '[': res = json_project_array(doc, parser, pointer, paths, count, value, end); break;
+		default: return json_doc_skip_value(doc, pointer, end);
+	}
+	if (res) return res;
+	// Members and elements only land in the container when they were kept themselves.
+	*kept = value->value_type == JSON_OBJECT_TYPE_OBJECT ? value->object->count > 0 : value->array->length > 0;
+	if (!*kept) json_value_free(value, parser->allocator);
+	return 0;
+}
+
+int32_t json_parse_projected(json_parser_t *const parser, json_value_t *value, const char *const data, size_t len, const char *const *paths) {
+	if (!parser || !value || !data || !paths) return CSON_ERR_NULL_PTR;
+	int res = 0;
+	size_t count = 0;
+	for (; paths[count]; ++count) {
+		res = json_pointer_validate(paths[count]);
+		if (res) goto done;
+	}
+	json_cursor_t doc;
+	res = json_doc_init(&doc, data, len);
+	if (res) goto done;
+	const char **selected = json_allocator_malloc(parser->scratch_allocator, (count ? count : 1) * sizeof(const char *));
+	if (!selected) {
+		res = CSON_ERR_ALLOC;
+		goto done;
+	}
+	memcpy(selected, paths, count * sizeof(const char *));
+	json_value_t projected;
+	bool kept;
+	size_t end;
+	res = json_project_value(&doc, parser, doc.pointer, selected, count, &projected, &kept, &end);
+	json_allocator_free(parser->scratch_allocator, selected, (count ? count : 1) * sizeof(const char *));
+	if (res) goto done;
+	end = json_doc_skip_whitespace(&doc, end);
+	if (end != len) {
+		json_error("Found trailing character \'%c\' at index %zu", data[end], end);
+		if (kept) json_value_free(&projected, parser->allocator);
+		res = CSON_PARSER_STATE_INVALID_CHARACTER;
+		goto done;
+	}
+	if (!kept) {
+		res = CSON_ERR_NOT_FOUND;
+		goto done;
+	}
+	*value = projected;
+	done:
+	json_parser_free(parser);
+	return res;
+}
@@ -1,5 +1,15 @@
+#define _LARGEFILE64_SOURCE
 #include "../include/cson_parser.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
 const char *get_state_name(json_parser_state_t state) {
 	switch (state) {
 		case CSON_PARSER_STATE_IDLE: {
@@ -52,38 +62,182 @@ void json_parser_print_state(const json_parser_t *const parser) {
 	}
 }
 
-int32_t json_parser_push_key(json_parser_t *parser) {
+bool json_parser_borrows(const json_parser_t *const parser) {
+	return (parser->options & (CSON_PARSER_OPTION_ZERO_COPY | CSON_PARSER_OPTION_INSITU)) && parser->input;
+}
+
+// Strings and keys start out as views of the input right after their opening
+// quote when the parser is allowed to borrow from it, as empty inline strings otherwise.
+json_string_t json_parser_string_start(const json_parser_t *const parser, const char *const start) {
+	if (!json_parser_borrows(parser)) return json_string_empty();
+	return (json_string_t){
+		.buf = (char *)start
+	};
+}
+
+// Keys that end up interned only need to live until KEY_END, so they borrow from
+// the input whenever there is one.
+static inline bool json_parser_borrows_keys(const json_parser_t *const parser) {
+	return json_parser_borrows(parser) || (parser->intern && parser->input);
+}
+
+int32_t json_parser_append_char(json_parser_t *parser, json_string_t *str, const char ch) {
+	if (json_string_is_borrowed(str) && parser->input) {
+		// A view never runs ahead of the read position, so while the decoded character
+		// is the one already sitting in the input the view just grows over it. The first
+		// escape that decodes to something else turns the string into an owned copy.
+		if (str->buf[str->length] == ch) {
+			str->length++;
+			return 0;
+		}
+		// In place the decoded character simply overwrites input we already consumed.
+		if (parser->options & CSON_PARSER_OPTION_INSITU) {
+			str->buf[str->length++] = ch;
+			return 0;
+		}
+	}
+	return json_string_append_char(str, ch, parser->allocator);
+}
+
+// Appends input[0, length) that needs no decoding. A view that ends right where the
+// run starts just grows over it, otherwise the run is copied with one memcpy.
+int32_t json_parser_append_run(json_parser_t *parser, json_string_t *str, const char *const input, ssize_t length) {
+	if (json_string_is_borrowed(str) && parser->input) {
+		if (str->buf + str->length == input) {
+			str->length += length;
+			return 0;
+		}
+		if (parser->options & CSON_PARSER_OPTION_INSITU) {
+			memmove(str->buf + str->length, input, length);
+			str->length += length;
+			return 0;
+		}
+	}
+	return json_string_append_buf(str, input, length, parser->allocator);
+}
+
+// The string a KEY or STRING state is filling in. String values are built in
+// parser->string and only moved into their json_value_t once they are complete.
+static inline json_string_t *json_parser_current_string(json_parser_t *parser, json_parser_state_t state) {
+	return state == CSON_PARSER_STATE_KEY
+		? &parser->temporary_keys[parser->key_count - 1]
+		: &parser->string;
+}
+
+// Length of the escape sequence starting with the backslash at escape[0], or 0 while
+// fewer than `available` bytes cannot tell yet. Whatever is not a valid escape is
+// left for json_string_unescape to reject.
+static ssize_t json_parser_escape_length(const char *const escape, ssize_t available) {
+	if (available < 2) return 0;
+	if (escape[1] != 'u') return 2;
+	if (available < 6) return 0;
+	// The high half of a surrogate pair is only valid together with its low half.
+	bool high_surrogate = (escape[2] == 'd' || escape[2] == 'D')
+		&& ((escape[3] >= '8' && escape[3] <= '9') || (escape[3] >= 'a' && escape[3] <= 'b') || (escape[3] >= 'A' && escape[3] <= 'B'));
+	if (!high_surrogate) return 6;
+	return available < CSON_PARSER_ESCAPE_MAX ? 0 : CSON_PARSER_ESCAPE_MAX;
+}
+
+// Decodes the complete escape sequence escape[0, length) with json_string_unescape
+// and appends the result, in place for in-situ strings.
+static int32_t json_parser_append_escape(json_parser_t *parser, json_string_t *str, const char *const escape, ssize_t length) {
+	char sequence[CSON_PARSER_ESCAPE_MAX + 1];
+	char decoded[CSON_PARSER_ESCAPE_MAX];
+	size_t decoded_length, consumed;
+	memcpy(sequence, escape, length);
+	sequence[length] = '\"';
+	if (json_string_unescape(sequence, length + 1, decoded, &decoded_length, &consumed) || (ssize_t)consumed != length + 1) {
+		json_error("Invalid escape sequence \'%.*s\' at index %zd", (int)length, escape, parser->pointer);
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	return json_parser_append_run(parser, str, decoded, decoded_length);
+}
+
+// Terminates an in-situ string over its closing quote (or earlier, when escapes
+// shrank it), so it can be handed to C string functions as is.
+void json_parser_string_end(const json_parser_t *const parser, json_string_t *str) {
+	if (json_string_is_borrowed(str) && (parser->options & CSON_PARSER_OPTION_INSITU)) {
+		str->buf[str->length] = '\0';
+	}
+}
+
+// A container is only filled once it closes, when all of its `count` members sit on
+// the temporaries stack. It is opened without storage and gets exactly that many
+// slots here, a container closed again keeps growing from what it has.
+static int32_t json_parser_size_object(const json_parser_t *const parser, json_object_t *obj, ssize_t count) {
+	if (obj->buckets) return json_object_reserve(obj, obj->count + count);
+	return json_object_init(obj, count > 0 ? count : 1, parser->allocator);
+}
+
+static int32_t json_parser_size_array(const json_parser_t *const parser, json_array_t *arr, ssize_t count) {
+	if (arr->objects) return json_array_reserve(arr, arr->length + count);
+	return json_array_init(arr, count > 0 ? count : 1, parser->allocator);
+}
+
+// Gives back the spare bytes of an owned key, for CSON_PARSER_OPTION_EXACT_SIZE.
+static int32_t json_parser_fit_key(const json_parser_t *const parser, json_string_t *key) {
+	if (key->size <= 0 || !key->buf || key->size == key->length + 1) return 0;
+	char *buf = json_allocator_realloc(parser->allocator, key->buf, key->size, key->length + 1);
+	if (!buf) return CSON_ERR_ALLOC;
+	key->buf = buf;
+	key->size = key->length + 1;
+	return 0;
+}
+
+// Moves a finished member into `obj`, the first of several equal keys wins and
+// the later duplicate is dropped.
+static int32_t json_parser_move_member(json_parser_t *parser, json_object_t *obj, json_string_t *key, json_value_t *value) {
+	int res = json_object_move_value(obj, key, value);
+	if (res == CSON_ERR_ILLEGAL_OPERATION) {
+		json_string_free(key, parser->allocator);
+		json_value_free(value, parser->allocator);
+		res = 0;
+	}
+	if (res) return res;
+	*key = (json_string_t){};
+	*value = (json_value_t){};
+	return 0;
+}
+
+// Swaps a finished key for its interned view, dropping the parser's own copy.
+static int32_t json_parser_intern_key(json_parser_t *parser, json_string_t *key) {
+	json_string_t interned;
+	int res = json_intern(parser->intern, json_string_data(key), key->length, &interned);
+	if (res) return res;
+	json_string_free(key, parser->allocator);
+	*key = interned;
+	return 0;
+}
+
+int32_t json_parser_push_key(json_parser_t *parser, const char *const start) {
 	if (parser->key_count == parser->key_size) {
 		ssize_t nsz = parser->key_size * 2;
-		json_string_t *tmp = realloc(parser->temporary_keys, nsz * sizeof(json_string_t));
+		json_string_t *tmp = json_allocator_realloc(parser->scratch_allocator, parser->temporary_keys, parser->key_size * sizeof(json_string_t), nsz * sizeof(json_string_t));
 		if (!tmp) {
-			fprintf(stderr, LOG_STRING"Failed to allocate memory for keys\n", __FILE__, __LINE__);
+			json_error("Failed to allocate memory for keys");
 			return CSON_ERR_ALLOC;
 		}
 		parser->temporary_keys = tmp;
 		parser->key_size =  nsz;
 	}
-	char *tmp = debug_malloc(8 * sizeof(char));
-	if (!tmp) {
-		fprintf(stderr, LOG_STRING"Failed to allocate memory for new key\n", __FILE__, __LINE__);
-		return CSON_ERR_ALLOC;
+	if (json_parser_borrows_keys(parser)) {
+		parser->temporary_keys[parser->key_count++] = (json_string_t){
+			.buf = (char *)start
+		};
+		return 0;
 	}
-	// printf("parser->key_count: %lld, size: %lld\n", parser->key_count, parser->key_size);
-	parser->temporary_keys[parser->key_count] = (json_string_t){
-		.buf = tmp,
-		.size = 8
-	};
-	parser->key_count++;
+	// Most keys fit inline and never allocate.
+	parser->temporary_keys[parser->key_count++] = json_string_empty();
 	return 0;
 }
 
 int32_t json_parser_pop_key(json_parser_t *parser, json_string_t *key) {
 	if (parser->key_count <= 0) {
-		fprintf(stderr, LOG_STRING"Tried to pop key when the array is empty\n", __FILE__, __LINE__);
+		json_error("Tried to pop key when the array is empty");
 		return CSON_ERR_ILLEGAL_OPERATION;
 	}
 	if (key) *key = parser->temporary_keys[parser->key_count - 1];
-	else json_string_free(&parser->temporary_keys[parser->key_count - 1]);
+	else json_string_free(&parser->temporary_keys[parser->key_count - 1], parser->allocator);
 	parser->key_count--;
 	return 0;
 }
@@ -93,24 +247,24 @@ int32_t json_parser_pop_key(json_parser_t *parser, json_string_t *key) {
 int32_t json_parser_push_state(json_parser_t *parser, json_parser_state_t state) { 
 	if (parser->state_count >= parser->state_size) {
 		ssize_t nsz = parser->state_size * 2;
-		json_parser_state_t *tmp = debug_realloc(parser->states, nsz * sizeof(json_parser_state_t));
+		json_parser_state_t *tmp = json_allocator_realloc(parser->scratch_allocator, parser->states, parser->state_size * sizeof(json_parser_state_t), nsz * sizeof(json_parser_state_t));
 		if (!tmp) {
-			fprintf(stderr, LOG_STRING"Failed to reallocate memory for state pointer with size %lld bytes\n", __FILE__, __LINE__, nsz * sizeof(json_parser_state_t));
+			json_error("Failed to reallocate memory for state pointer with size %lld bytes", nsz * sizeof(json_parser_state_t));
 			return CSON_ERR_ALLOC;
 		}
 		parser->states = tmp;
 		parser->state_size = nsz;
 	}
 	parser->states[parser->state_count++] = state;
-	printf("current stack:\n");
-	json_parser_print_state(parser);
+	json_trace("current stack:");
+	json_trace_dump(json_parser_print_state(parser));
 	return 0;
 }
 
 int32_t json_parser_push_temporary(json_parser_t *parser, const json_value_t *const val, bool copy) {
-	int res = 0;
-	if (copy) json_array_append_value(&parser->temporaries, val);
-	else json_array_move_value(&parser->temporaries, val);
+	int res = copy
+		? json_array_append_value(&parser->temporaries, val)
+		: json_array_move_value(&parser->temporaries, val);
 	if (res) {
 		return res;
 	}
@@ -119,13 +273,13 @@ int32_t json_parser_push_temporary(json_parser_t *parser, const json_value_t *co
 
 int32_t json_parser_pop_state(json_parser_t *parser,	json_parser_state_t *state) {
 	if (!parser->states || parser->state_count <= 0) {
-		fprintf(stderr, LOG_STRING"Tried to pop state when the array is empty\n", __FILE__, __LINE__);
+		json_error("Tried to pop state when the array is empty");
 		return CSON_ERR_ILLEGAL_OPERATION;
 	}
 	if (state) *state = parser->states[parser->state_count - 1];
 	parser->state_count--; 
-	printf("current stack:\n");
-	json_parser_print_state(parser);
+	json_trace("current stack:");
+	json_trace_dump(json_parser_print_state(parser));
 	return 0;
 }
 
@@ -137,6 +291,76 @@ int32_t json_parser_pop_temporary(json_parser_t *parser, json_value_t *val) {
 	return 0;
 }
 
+// Adds one digit of a double to the pending decimal decomposition.
+static int32_t json_parser_number_push_digit(json_parser_t *parser, const char ch, bool fraction) {
+	if (fraction) parser->decimal_exponent--;
+	// Leading zeros are not significant, "0.001" is 1 * 10^-3.
+	if (parser->mantissa_digits == 0 && ch == '0') return 0;
+	if (parser->mantissa_digits < CSON_NUMBER_MAX_DIGITS) {
+		parser->mantissa = parser->mantissa * 10 + (ch - '0');
+		parser->mantissa_digits++;
+		return 0;
+	}
+	if (parser->mantissa_digits == CSON_NUMBER_MAX_DIGITS) {
+		char digits[CSON_NUMBER_MAX_DIGITS + 1];
+		snprintf(digits, sizeof(digits), "%llu", (unsigned long long)parser->mantissa);
+		for (int32_t i = 0; i < CSON_NUMBER_MAX_DIGITS; ++i) {
+			int res = json_string_append_char(&parser->number_digits, digits[i], parser->scratch_allocator);
+			if (res) return res;
+		}
+	}
+	// The mantissa keeps its first 19 digits, the dropped one only scales it.
+	parser->decimal_exponent++;
+	parser->mantissa_digits++;
+	return json_string_append_char(&parser->number_digits, ch, parser->scratch_allocator);
+}
+
+// Starts the decimal decomposition of a number that turned out to be a double,
+// seeded with the magnitude of the integer parsed so far.
+static int32_t json_parser_number_start(json_parser_t *parser, uint64_t magnitude) {
+	parser->number_pending = true;
+	parser->mantissa = 0;
+	parser->mantissa_digits = 0;
+	parser->decimal_exponent = 0;
+	parser->number_digits.length = 0;
+	char digits[24];
+	int32_t count = 0;
+	do {
+		digits[count++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	while (count > 0) {
+		int res = json_parser_number_push_digit(parser, digits[--count], false);
+		if (res) return res;
+	}
+	return 0;
+}
+
+static int32_t json_parser_number_finish(json_parser_t *parser, bool negative, double *out) {
+	int64_t q = parser->decimal_exponent;
+	if (parser->found_number_after_exponent) q += parser->exponent;
+	if (parser->mantissa_digits <= CSON_NUMBER_MAX_DIGITS) {
+		if (json_number_compute_float(parser->mantissa, q, negative, out)) return 0;
+	} else {
+		// Truncated: if both neighbours of the kept prefix round the same way, so does the full number.
+		double lower, upper;
+		if (json_number_compute_float(parser->mantissa, q, negative, &lower)
+			&& json_number_compute_float(parser->mantissa + 1, q, negative, &upper)
+			&& lower == upper
+		) {
+			*out = lower;
+			return 0;
+		}
+	}
+	int64_t slow_q = q - (parser->mantissa_digits > CSON_NUMBER_MAX_DIGITS ? parser->mantissa_digits - CSON_NUMBER_MAX_DIGITS : 0);
+	if (parser->mantissa_digits <= CSON_NUMBER_MAX_DIGITS) {
+		char digits[CSON_NUMBER_MAX_DIGITS + 1];
+		int n = snprintf(digits, sizeof(digits), "%llu", (unsigned long long)parser->mantissa);
+		return json_number_parse_slow(digits, n, slow_q, negative, out);
+	}
+	return json_number_parse_slow(json_string_data(&parser->number_digits), parser->number_digits.length, slow_q, negative, out);
+}
+
 int32_t json_parser_handle_digit(json_parser_t *parser, json_parser_state_t *current_state, const char ch) {
 	if (parser->state_count <= 0) return CSON_PARSER_STATE_INVALID_CHARACTER;
 	switch (*current_state) {
@@ -148,79 +372,66 @@ int32_t json_parser_handle_digit(json_parser_t *parser, json_parser_state_t *cur
 		case CSON_PARSER_STATE_ARRAY: {
 			json_value_t new_val = {
 				.value_type = JSON_OBJECT_TYPE_NUMBER,
-				.number.num_type = JSON_NUMBER_TYPE_U64,
-				.number.u64 = ch - '0'
+				.num_type = JSON_NUMBER_TYPE_U64,
+				.u64 = ch - '0'
 			};
 			int res = json_parser_push_temporary(parser, &new_val, true);
 			if (res) return res;
-			printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
+			json_trace("Pushing state");
 			res = json_parser_push_state(parser, *current_state);
 			*current_state = CSON_PARSER_STATE_U64;
 			parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_TRAILING_COMMA);
 			if (res) return res;
 		} break;
 		case CSON_PARSER_STATE_F64: {
+			// Anything past +-3000 already saturates to zero or infinity, stop growing there.
 			if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_EXPONENT) {
-				parser->exponent = parser->exponent * 10 + (ch - '0');
+				if (parser->exponent < 3000) parser->exponent = parser->exponent * 10 + (ch - '0');
 				parser->found_number_after_exponent = true;
 				break;
 			} 
 			if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT) {
-				parser->exponent = parser->exponent * 10 - (ch - '0');
+				if (parser->exponent > -3000) parser->exponent = parser->exponent * 10 - (ch - '0');
 				parser->found_number_after_exponent = true;
 				break;
 			}
-			double f = parser->temporaries.objects[parser->temporaries.length - 1].number.f64;
-			// printf("f: %e, digit: %c\n", f, ch);
 			if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_PERIOD) {
-				double mantissa = ch - '0';
-				parser->exponent++;
-				// printf("exponent: %hd\n", parser->exponent);
-				for (ssize_t p = 0; p < parser->exponent; ++p) {
-					mantissa /= 10;
-				}
-				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN) {
-					f -= mantissa;
-					parser->found_number_after_sign = true;
-				}
-				else f += mantissa;
-				parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
+				int res = json_parser_number_push_digit(parser, ch, true);
+				if (res) return res;
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN) parser->found_number_after_sign = true;
 				parser->found_number_after_period = true;
 				break;
 			} 
-			f *= 10;
-			if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN) f -= ch - '0';
-			else f += ch - '0';
-			parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
+			int res = json_parser_number_push_digit(parser, ch, false);
+			if (res) return res;
 		} break;
 		case CSON_PARSER_STATE_U64: {
-			uint64_t num = parser->temporaries.objects[parser->temporaries.length - 1].number.u64;
+			uint64_t num = parser->temporaries.objects[parser->temporaries.length - 1].u64;
 			if (num >= UINT64_MAX / 10 - (ch - '0')) {
 				*current_state = CSON_PARSER_STATE_F64;
-				double f = num;
-				f = f * 10 + ch - '0';
-				parser->temporaries.objects[parser->temporaries.length - 1].number.num_type = JSON_NUMBER_TYPE_F64;
-				parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
+				parser->temporaries.objects[parser->temporaries.length - 1].num_type = JSON_NUMBER_TYPE_F64;
+				int res = json_parser_number_start(parser, num);
+				if (res) return res;
+				res = json_parser_number_push_digit(parser, ch, false);
+				if (res) return res;
 				break;
 			}
 			num *= 10;
 			num += ch - '0';
-			parser->temporaries.objects[parser->temporaries.length - 1].number.u64 = num;
+			parser->temporaries.objects[parser->temporaries.length - 1].u64 = num;
 			parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_TRAILING_COMMA);
 		} break;
 		case CSON_PARSER_STATE_I64: {
-			int64_t num = parser->temporaries.objects[parser->temporaries.length - 1].number.i64;
+			int64_t num = parser->temporaries.objects[parser->temporaries.length - 1].i64;
 			// printf("num: %lld, digit: %c\n", num, ch);
 			if (num >= INT64_MAX / 10 - (ch - '0') || num <= INT64_MIN / 10 + (ch - '0')) {
 				*current_state = CSON_PARSER_STATE_F64;
-				double f = num;
-				f *= 10;
-				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN) {
-					f -= ch - '0';
-					parser->found_number_after_sign = true;
-				} else f += ch - '0';
-				parser->temporaries.objects[parser->temporaries.length - 1].number.num_type = JSON_NUMBER_TYPE_F64;
-				parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN) parser->found_number_after_sign = true;
+				parser->temporaries.objects[parser->temporaries.length - 1].num_type = JSON_NUMBER_TYPE_F64;
+				int res = json_parser_number_start(parser, num < 0 ? 0 - (uint64_t)num : (uint64_t)num);
+				if (res) return res;
+				res = json_parser_number_push_digit(parser, ch, false);
+				if (res) return res;
 				break;
 			}
 			num *= 10;
@@ -229,19 +440,9 @@ int32_t json_parser_handle_digit(json_parser_t *parser, json_parser_state_t *cur
 				parser->found_number_after_sign = true;
 			}
 			else num += ch - '0';
-			parser->temporaries.objects[parser->temporaries.length - 1].number.i64 = num;
+			parser->temporaries.objects[parser->temporaries.length - 1].i64 = num;
 			parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_TRAILING_COMMA);
 		} break;
-		case CSON_PARSER_STATE_STRING: {
-			json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-			int res = json_string_append_char(str, ch);
-			if (res) return res;
-		} break;
-		case CSON_PARSER_STATE_KEY: {
-			json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-			int res = json_string_append_char(str, ch);
-			if (res) return res;
-		} break;
 		default: {
 			return CSON_PARSER_STATE_INVALID_CHARACTER;
 		} 
@@ -249,158 +450,120 @@ int32_t json_parser_handle_digit(json_parser_t *parser, json_parser_state_t *cur
 	return 0;
 }
 
+// Consumes the digits following the one at parser->pointer in one go, eight at a
+// time where possible. Overflow is ruled out once for the whole run, a run that
+// might overflow is left to json_parser_handle_digit so it can turn into a double.
+static int32_t json_parser_scan_integer(json_parser_t *parser, json_parser_state_t current_state, const char *const buf, ssize_t n) {
+	static const uint64_t powers_of_ten[] = {
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+		1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+		100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+		1000000000000000000ULL, 10000000000000000000ULL
+	};
+	const char *const start = buf + parser->pointer + 1;
+	ssize_t available = n - parser->pointer - 1;
+	ssize_t count = 0;
+	while (count + 8 <= available && json_number_is_eight_digits(start + count)) count += 8;
+	while (count < available && isdigit(start[count])) count++;
+	if (count == 0 || count > CSON_NUMBER_MAX_DIGITS) return 0;
+	json_value_t *number = &parser->temporaries.objects[parser->temporaries.length - 1];
+	// I64 is only entered through '-', so its digits build a negative number.
+	uint64_t magnitude = current_state == CSON_PARSER_STATE_I64 ? 0 - (uint64_t)number->i64 : number->u64;
+	uint64_t limit = current_state == CSON_PARSER_STATE_I64 ? (uint64_t)INT64_MAX + 1 : UINT64_MAX;
+	if (powers_of_ten[count] - 1 > limit || magnitude > (limit - (powers_of_ten[count] - 1)) / powers_of_ten[count]) return 0;
+	ssize_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		magnitude = magnitude * 100000000ULL + json_number_parse_eight_digits(start + i);
+	}
+	for (; i < count; ++i) {
+		magnitude = magnitude * 10 + (start[i] - '0');
+	}
+	if (current_state == CSON_PARSER_STATE_I64) {
+		number->i64 = (int64_t)(0 - magnitude);
+		parser->found_number_after_sign = true;
+	} else {
+		number->u64 = magnitude;
+	}
+	parser->pointer += count;
+	return 0;
+}
+
+// Finishes a null literal whose last character was just read.
+static int32_t json_parser_push_null(json_parser_t *parser) {
+	parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_NULL_L1 | CSON_PARSER_FLAG_FOUND_TRAILING_COMMA);
+	json_value_t val = {
+		.value_type = JSON_OBJECT_TYPE_NULL
+	};
+	int res = json_parser_push_temporary(parser, &val, false);
+	if (res) {
+		json_error("Failed to push null object into parser temporary due to error %d", res);
+		return res;
+	}
+	return 0;
+}
+
 int32_t json_parser_handle_char(json_parser_t *parser, json_parser_state_t *current_state, const char ch) {
 	if (parser->state_count <= 0) return CSON_PARSER_STATE_INVALID_CHARACTER;
 	switch (*current_state) {
 		case CSON_PARSER_STATE_I64: {
-			if ((ch != 'e' && ch != 'E') || parser->temporaries.objects[parser->temporaries.length - 1].number.i64 == 0) {
-				fprintf(stderr, LOG_STRING"Invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-				exit(-1);
+			if ((ch != 'e' && ch != 'E') || parser->temporaries.objects[parser->temporaries.length - 1].i64 == 0) {
+				json_error("Invalid character %c at index %lld", ch, parser->pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
-			double f = parser->temporaries.objects[parser->temporaries.length - 1].number.i64;
-			parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
-			parser->temporaries.objects[parser->temporaries.length - 1].number.num_type = JSON_NUMBER_TYPE_F64;
-			printf("Found exponent at index %lld\n", parser->pointer);
+			int64_t num = parser->temporaries.objects[parser->temporaries.length - 1].i64;
+			int res = json_parser_number_start(parser, num < 0 ? 0 - (uint64_t)num : (uint64_t)num);
+			if (res) return res;
+			parser->temporaries.objects[parser->temporaries.length - 1].num_type = JSON_NUMBER_TYPE_F64;
+			json_trace("Found exponent at index %lld", parser->pointer);
 			parser->parser_flag |= CSON_PARSER_FLAG_FOUND_EXPONENT;
 			parser->exponent = 0;
 			*current_state = CSON_PARSER_STATE_F64;
 		} break;
 		case CSON_PARSER_STATE_U64: {
-			if ((ch != 'e' && ch != 'E') || parser->temporaries.objects[parser->temporaries.length - 1].number.u64 == 0) {
-				fprintf(stderr, LOG_STRING"Invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-				exit(-1);
+			if ((ch != 'e' && ch != 'E') || parser->temporaries.objects[parser->temporaries.length - 1].u64 == 0) {
+				json_error("Invalid character %c at index %lld", ch, parser->pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
-			double f = parser->temporaries.objects[parser->temporaries.length - 1].number.u64;
-			parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
-			parser->temporaries.objects[parser->temporaries.length - 1].number.num_type = JSON_NUMBER_TYPE_F64;
-			printf("Found exponent at index %lld\n", parser->pointer);
+			int res = json_parser_number_start(parser, parser->temporaries.objects[parser->temporaries.length - 1].u64);
+			if (res) return res;
+			parser->temporaries.objects[parser->temporaries.length - 1].num_type = JSON_NUMBER_TYPE_F64;
+			json_trace("Found exponent at index %lld", parser->pointer);
 			parser->parser_flag |= CSON_PARSER_FLAG_FOUND_EXPONENT;
 			parser->exponent = 0;
 			*current_state = CSON_PARSER_STATE_F64;
 		} break;
 		case CSON_PARSER_STATE_F64: {
 			if (ch != 'e' && ch != 'E') {
-				fprintf(stderr, LOG_STRING"Invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-				exit(-1);
+				json_error("Invalid character %c at index %lld", ch, parser->pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
 			if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT)) {
-				fprintf(stderr, LOG_STRING"Found duplicate exponent %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-				exit(-1);
+				json_error("Found duplicate exponent %c at index %lld", ch, parser->pointer);
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
-			printf("Found exponent at index %lld\n", parser->pointer);
+			json_trace("Found exponent at index %lld", parser->pointer);
 			parser->exponent = 0;
 			parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_PERIOD) | CSON_PARSER_FLAG_FOUND_EXPONENT;
 		} break;
 		case CSON_PARSER_STATE_OBJECT:
 		case CSON_PARSER_STATE_ARRAY: {
 			if (!(parser->parser_flag & (CSON_PARSER_FLAG_FOUND_NULL_N | CSON_PARSER_FLAG_FOUND_NULL_U | CSON_PARSER_FLAG_FOUND_NULL_L1))) {
-				if (ch != 'n') {
-					fprintf(stderr, LOG_STRING"Found illegal character \'%c\' at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
+				if (ch != 'n' || (*current_state == CSON_PARSER_STATE_OBJECT && !(parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START))) {
+					json_error("Found illegal character \'%c\' at index %lld", ch, parser->pointer);
 					return CSON_PARSER_STATE_INVALID_CHARACTER;
 				}
-				printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-				json_parser_push_state(parser, *current_state);
+				json_trace("Pushing state");
+				int res = json_parser_push_state(parser, *current_state);
+				if (res) return res;
 				*current_state = CSON_PARSER_STATE_NULL; 
 				parser->parser_flag |= CSON_PARSER_FLAG_FOUND_NULL_N;
 				break;
 			}
 		} break;
-		case CSON_PARSER_STATE_ESCAPE: {
-			switch (ch) {
-				case 'r': {
-					switch (parser->states[parser->state_count - 1]) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							int res = json_string_append_char(str, '\r');
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							int res = json_string_append_char(str, '\r');
-							if (res) return res;
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"invalid state.\n", __FILE__, __LINE__);
-							exit(-1);
-						}
-					}
-				} break;
-				case 'n': {
-					switch (parser->states[parser->state_count - 1]) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							int res = json_string_append_char(str, '\n');
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							int res = json_string_append_char(str, '\n');
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"invalid state.\n", __FILE__, __LINE__);
-							exit(-1);
-						}
-					}
-				} break;
-				case 't': {
-					switch (parser->states[parser->state_count - 1]) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							int res = json_string_append_char(str, '\t');
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							int res = json_string_append_char(str, '\t');
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"invalid state.\n", __FILE__, __LINE__);
-							exit(-1);
-						}
-					}
-				} break;
-				default: {
-					fprintf(stderr, "Invalid escape character \\%c\n", ch);
-					return CSON_PARSER_STATE_INVALID_CHARACTER;
-				} break;
-			}
-			printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-			json_parser_pop_state(parser, current_state);
-		} break;
-		case CSON_PARSER_STATE_KEY: {
-			json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-			int res = json_string_append_char(str, ch);
-			if (res) {
-				fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-				return res;
-			}
-		} break;
-		case CSON_PARSER_STATE_STRING: {
-			json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-			int res = json_string_append_char(str, ch);
-			if (res) {
-				fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-				return res;
-			}
-		} break;
 		case CSON_PARSER_STATE_NULL: {
 			if ((parser->parser_flag & CSON_PARSER_FLAG_FOUND_NULL_N)) {
 				if (ch != 'u'){
-					fprintf(stderr, LOG_STRING"Found illegal character \'%c\' at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
+					json_error("Found illegal character \'%c\' at index %lld", ch, parser->pointer);
 					return CSON_PARSER_STATE_INVALID_CHARACTER;
 				}
 				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_NULL_N) | CSON_PARSER_FLAG_FOUND_NULL_U;
@@ -408,7 +571,7 @@ int32_t json_parser_handle_char(json_parser_t *parser, json_parser_state_t *curr
 			}
 			if ((parser->parser_flag & CSON_PARSER_FLAG_FOUND_NULL_U)) {
 				if (ch != 'l'){
-					fprintf(stderr, LOG_STRING"Found illegal character \'%c\' at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
+					json_error("Found illegal character \'%c\' at index %lld", ch, parser->pointer);
 					return CSON_PARSER_STATE_INVALID_CHARACTER;
 				}
 				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_NULL_U) | CSON_PARSER_FLAG_FOUND_NULL_L1;
@@ -416,22 +579,13 @@ int32_t json_parser_handle_char(json_parser_t *parser, json_parser_state_t *curr
 			}
 			if ((parser->parser_flag & CSON_PARSER_FLAG_FOUND_NULL_L1)) {
 				if (ch != 'l'){
-					fprintf(stderr, LOG_STRING"Found illegal character \'%c\' at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
+					json_error("Found illegal character \'%c\' at index %lld", ch, parser->pointer);
 					return CSON_PARSER_STATE_INVALID_CHARACTER;
 				}
-				parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_VALUE_START |CSON_PARSER_FLAG_FOUND_NULL_L1 | CSON_PARSER_FLAG_FOUND_TRAILING_COMMA);
-				// printf(LOG_STRING"Found null object.\n", __FILE__, __LINE__);
-				json_value_t val = {
-					.value_type = JSON_OBJECT_TYPE_NULL,
-					.null = (json_null_t){}
-				};
-				int res = json_parser_push_temporary(parser, &val, false);
-				if (res) {
-					fprintf(stderr, LOG_STRING"Failed to push null object into parser temporary due to error %d\n", __FILE__, __LINE__, res);
-					return res;
-				}
+				int res = json_parser_push_null(parser);
+				if (res) return res;
 				*current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-				printf("Expecting comma or end\n");
+				json_trace("Expecting comma or end");
 			}
 		} break;
 		default: {
@@ -442,77 +596,55 @@ int32_t json_parser_handle_char(json_parser_t *parser, json_parser_state_t *curr
 }
 
 int32_t validate_number(json_parser_t *parser) {
-	switch (parser->temporaries.objects[parser->temporaries.length - 1].number.num_type) {
+	switch (parser->temporaries.objects[parser->temporaries.length - 1].num_type) {
 		case JSON_NUMBER_TYPE_I64: {
 			if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_SIGN) && !parser->found_number_after_sign) {
-				fprintf(stderr, LOG_STRING"Found invalid sign symbol (no number after \'-\')\n", __FILE__, __LINE__);
+				json_error("Found invalid sign symbol (no number after \'-\')");
 				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
 		} break;
 		case JSON_NUMBER_TYPE_F64: {
 			if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT) && !parser->found_number_after_exponent) {
-				fprintf(stderr, LOG_STRING"Found invalid exponent symbol (no number after \'e\')\n", __FILE__, __LINE__);
+				json_error("Found invalid exponent symbol (no number after \'e\')");
 				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
 			if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_PERIOD) && !parser->found_number_after_period) {
 				if (!parser->exponent) {
-					fprintf(stderr, LOG_STRING"Found invalid period symbol (no number after \'.\')\n", __FILE__, __LINE__);
+					json_error("Found invalid period symbol (no number after \'.\')");
 					return CSON_PARSER_STATE_INVALID_CHARACTER;
 				}
 			}
 			if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_SIGN) && !parser->found_number_after_sign) {
-				fprintf(stderr, LOG_STRING"Found invalid sign symbol (no number after \'-\')\n", __FILE__, __LINE__);
+				json_error("Found invalid sign symbol (no number after \'-\')");
 				return CSON_PARSER_STATE_INVALID_CHARACTER;
 			}
 			
-			parser->found_number_after_period = false;
-			double f = parser->temporaries.objects[parser->temporaries.length - 1].number.f64;
-			// printf("exponent: %hd\n", parser->exponent);
-			if (parser->found_number_after_exponent) {
-				if (parser->exponent < 0) {
-					while (parser->exponent + 100 < -100) {
-						f /= 1e100;
-						parser->exponent += 100;
-					}
-					while (parser->exponent + 10 < -10) {
-						f /= 1e10;
-						parser->exponent += 10;
-					}
-					while (parser->exponent < 0) {
-						f /= 10;
-						parser->exponent++;
-					}
-				} else if (parser->exponent > 0) {
-					while (parser->exponent - 100 > 100) {
-						f *= 1e100;
-						parser->exponent -= 100;
-					}
-					while (parser->exponent - 10 > 10) {
-						f *= 1e10;
-						parser->exponent -= 10;
-					}
-					while (parser->exponent > 0) {
-						f *= 10;
-						parser->exponent--;
-					}
-				}
+			// Numbers reaching '}' or ']' are validated twice, only convert the first time.
+			if (parser->number_pending) {
+				double f;
+				int res = json_parser_number_finish(parser, parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN, &f);
+				if (res) return res;
+				parser->temporaries.objects[parser->temporaries.length - 1].f64 = f;
+				parser->number_pending = false;
+				parser->exponent = 0;
 			}
-			parser->found_number_after_sign = false;
-			parser->found_number_after_exponent = false;
-			parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
-			parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
 		} break;
 		default: {} break;
 	}
+	// The number has ended, its sign must not carry over to the next one.
+	parser->found_number_after_sign = false;
+	parser->found_number_after_period = false;
+	parser->found_number_after_exponent = false;
+	parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
 	return 0;
 }
 
 int32_t json_parser_push_depth(json_parser_t *const parser) {
 	if (parser->depth_count == parser->depth_size) {
 		ssize_t nsz = parser->depth_size * 2;
-		ssize_t *tmp = realloc(parser->depth, nsz * sizeof(ssize_t));
+		ssize_t *tmp = json_allocator_realloc(parser->scratch_allocator, parser->depth, parser->depth_size * sizeof(ssize_t), nsz * sizeof(ssize_t));
 		if (!tmp) {
-			fprintf(stderr, LOG_STRING"Failed to allocate memory for depth\n", __FILE__, __LINE__);
+			json_error("Failed to allocate memory for depth");
 			return CSON_ERR_ALLOC;
 		}
 		parser->depth = tmp;
@@ -531,25 +663,41 @@ int32_t json_parser_pop_depth(json_parser_t *const parser, ssize_t *ptr) {
 }
 
 int32_t json_parser_init(json_parser_t *const parser) {
+	return json_parser_init_with_allocator(parser, NULL);
+}
+
+int32_t json_parser_init_with_allocator(json_parser_t *const parser, const json_allocator_t *allocator) {
 	if (!parser) return CSON_ERR_NULL_PTR;
-	parser->states = debug_malloc(8 * sizeof(json_parser_state_t));
+	allocator = json_allocator_resolve(allocator);
+	parser->allocator = allocator;
+	parser->scratch_allocator = allocator;
+	parser->states = json_allocator_malloc(allocator, 8 * sizeof(json_parser_state_t));
 	if (!parser->states) return CSON_ERR_ALLOC;
-	parser->temporary_keys = debug_calloc(8, sizeof(json_string_t));
+	parser->temporary_keys = json_allocator_malloc(allocator, 8 * sizeof(json_string_t));
 	if (!parser->temporary_keys) {
-		debug_free(parser->states);
+		json_allocator_free(allocator, parser->states, 8 * sizeof(json_parser_state_t));
 		return CSON_ERR_ALLOC;
 	}
-	int res = json_array_init(&parser->temporaries, 8); 
+	memset(parser->temporary_keys, 0, 8 * sizeof(json_string_t));
+	int res = json_array_init(&parser->temporaries, 8, allocator); 
 	if (res) {
-		debug_free(parser->states);
-		debug_free(parser->temporary_keys);
+		json_allocator_free(allocator, parser->states, 8 * sizeof(json_parser_state_t));
+		json_allocator_free(allocator, parser->temporary_keys, 8 * sizeof(json_string_t));
 		return res;
 	}
-	parser->depth = debug_malloc(sizeof(ssize_t) * 8);
+	parser->depth = json_allocator_malloc(allocator, 8 * sizeof(ssize_t));
 	if (!parser->depth) {
-		debug_free(parser->states);
-		debug_free(parser->temporary_keys);
-		debug_free(parser->temporaries.objects);
+		json_allocator_free(allocator, parser->states, 8 * sizeof(json_parser_state_t));
+		json_allocator_free(allocator, parser->temporary_keys, 8 * sizeof(json_string_t));
+		json_array_free(&parser->temporaries);
+		return CSON_ERR_ALLOC;
+	}
+	res = json_structural_index_init(&parser->index, BUFFER_SIZE, allocator);
+	if (res) {
+		json_allocator_free(allocator, parser->states, 8 * sizeof(json_parser_state_t));
+		json_allocator_free(allocator, parser->temporary_keys, 8 * sizeof(json_string_t));
+		json_array_free(&parser->temporaries);
+		json_allocator_free(allocator, parser->depth, 8 * sizeof(ssize_t));
 		return res;
 	}
 	parser->depth_count = 0;
@@ -561,8 +709,15 @@ int32_t json_parser_init(json_parser_t *const parser) {
 	parser->found_number_after_period = false;
 	parser->found_number_after_exponent = false;
 	parser->exponent = 0;
+	parser->number_pending = false;
+	parser->number_digits = (json_string_t){};
+	parser->string = (json_string_t){};
+	parser->escape_length = 0;
 	memset(parser->buf, 0, BUFFER_SIZE);
 	parser->parser_flag = 0;
+	parser->options = 0;
+	parser->input = NULL;
+	parser->intern = NULL;
 	parser->value = (json_value_t){};
 	return 0;
 }
@@ -608,1014 +763,915 @@ void json_parser_flags_printf(uint16_t flags) {
 	printf("--------------------------\n");
 }
 
-int32_t json_parser_digest(json_parser_t *const parser, ssize_t n) {
-	if (!parser || !parser->states || !parser->temporaries.objects || !parser->temporary_keys) return CSON_ERR_NULL_PTR;
-	if (n < 0) return CSON_ERR_INVALID_ARGUMENT; 
-	json_parser_state_t current_state = CSON_PARSER_STATE_IDLE; 
+// Every byte is reduced to one of these classes before the state machine sees it.
+typedef enum {
+	JSON_CHAR_CLASS_OTHER,
+	JSON_CHAR_CLASS_NUL,
+	JSON_CHAR_CLASS_WHITESPACE,
+	JSON_CHAR_CLASS_ALPHA,
+	JSON_CHAR_CLASS_DIGIT,
+	JSON_CHAR_CLASS_QUOTE,
+	JSON_CHAR_CLASS_BACKSLASH,
+	JSON_CHAR_CLASS_MINUS,
+	JSON_CHAR_CLASS_PERIOD,
+	JSON_CHAR_CLASS_COLON,
+	JSON_CHAR_CLASS_COMMA,
+	JSON_CHAR_CLASS_OBJECT_OPEN,
+	JSON_CHAR_CLASS_OBJECT_CLOSE,
+	JSON_CHAR_CLASS_ARRAY_OPEN,
+	JSON_CHAR_CLASS_ARRAY_CLOSE,
+	__JSON_CHAR_CLASS_MAX
+} json_char_class_t;
+
+static const uint8_t json_char_classes[256] = {
+	['\0'] = JSON_CHAR_CLASS_NUL,
+	[' '] = JSON_CHAR_CLASS_WHITESPACE,
+	['\t'] = JSON_CHAR_CLASS_WHITESPACE,
+	['\n'] = JSON_CHAR_CLASS_WHITESPACE,
+	['\r'] = JSON_CHAR_CLASS_WHITESPACE,
+	['a' ... 'z'] = JSON_CHAR_CLASS_ALPHA,
+	['A' ... 'Z'] = JSON_CHAR_CLASS_ALPHA,
+	['0' ... '9'] = JSON_CHAR_CLASS_DIGIT,
+	['\"'] = JSON_CHAR_CLASS_QUOTE,
+	['\\'] = JSON_CHAR_CLASS_BACKSLASH,
+	['-'] = JSON_CHAR_CLASS_MINUS,
+	['.'] = JSON_CHAR_CLASS_PERIOD,
+	[':'] = JSON_CHAR_CLASS_COLON,
+	[','] = JSON_CHAR_CLASS_COMMA,
+	['{'] = JSON_CHAR_CLASS_OBJECT_OPEN,
+	['}'] = JSON_CHAR_CLASS_OBJECT_CLOSE,
+	['['] = JSON_CHAR_CLASS_ARRAY_OPEN,
+	[']'] = JSON_CHAR_CLASS_ARRAY_CLOSE,
+};
+
+// What json_parser_digest does for a character class in a given state. Pairs that
+// are not listed in json_parser_transitions are errors.
+typedef enum {
+	JSON_PARSER_ACTION_ERROR,
+	JSON_PARSER_ACTION_NONE,
+	JSON_PARSER_ACTION_APPEND,
+	JSON_PARSER_ACTION_CHAR,
+	JSON_PARSER_ACTION_DIGIT,
+	JSON_PARSER_ACTION_ESCAPE_START,
+	JSON_PARSER_ACTION_ESCAPED,
+	JSON_PARSER_ACTION_OBJECT_QUOTE,
+	JSON_PARSER_ACTION_ARRAY_QUOTE,
+	JSON_PARSER_ACTION_KEY_END,
+	JSON_PARSER_ACTION_STRING_END,
+	JSON_PARSER_ACTION_KEY_SEPARATOR,
+	JSON_PARSER_ACTION_NEGATIVE,
+	JSON_PARSER_ACTION_EXPONENT_SIGN,
+	JSON_PARSER_ACTION_FRACTION,
+	JSON_PARSER_ACTION_PERIOD,
+	JSON_PARSER_ACTION_NUMBER_END,
+	JSON_PARSER_ACTION_NUMBER_COMMA,
+	JSON_PARSER_ACTION_NULL_COMMA,
+	JSON_PARSER_ACTION_VALUE_SEPARATOR,
+	JSON_PARSER_ACTION_ROOT_OBJECT,
+	JSON_PARSER_ACTION_NESTED_OBJECT,
+	JSON_PARSER_ACTION_OBJECT_END,
+	JSON_PARSER_ACTION_ROOT_ARRAY,
+	JSON_PARSER_ACTION_NESTED_ARRAY,
+	JSON_PARSER_ACTION_ARRAY_END,
+	__JSON_PARSER_ACTION_MAX
+} json_parser_action_t;
+
+#define JSON_PARSER_STATE_COUNT (CSON_PARSER_STATE_INVALID_CHARACTER + 1)
+
+static const uint8_t json_parser_transitions[JSON_PARSER_STATE_COUNT][__JSON_CHAR_CLASS_MAX] = {
+	[CSON_PARSER_STATE_IDLE] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_OBJECT_OPEN] = JSON_PARSER_ACTION_ROOT_OBJECT,
+		[JSON_CHAR_CLASS_ARRAY_OPEN] = JSON_PARSER_ACTION_ROOT_ARRAY,
+	},
+	[CSON_PARSER_STATE_OBJECT] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_CHAR,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_DIGIT,
+		[JSON_CHAR_CLASS_QUOTE] = JSON_PARSER_ACTION_OBJECT_QUOTE,
+		[JSON_CHAR_CLASS_MINUS] = JSON_PARSER_ACTION_NEGATIVE,
+		[JSON_CHAR_CLASS_COLON] = JSON_PARSER_ACTION_KEY_SEPARATOR,
+		[JSON_CHAR_CLASS_OBJECT_OPEN] = JSON_PARSER_ACTION_NESTED_OBJECT,
+		[JSON_CHAR_CLASS_OBJECT_CLOSE] = JSON_PARSER_ACTION_OBJECT_END,
+		[JSON_CHAR_CLASS_ARRAY_OPEN] = JSON_PARSER_ACTION_NESTED_ARRAY,
+	},
+	[CSON_PARSER_STATE_KEY] = {
+		[JSON_CHAR_CLASS_OTHER] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_QUOTE] = JSON_PARSER_ACTION_KEY_END,
+		[JSON_CHAR_CLASS_BACKSLASH] = JSON_PARSER_ACTION_ESCAPE_START,
+		[JSON_CHAR_CLASS_MINUS] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_PERIOD] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_COLON] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_OBJECT_OPEN] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_OBJECT_CLOSE] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_ARRAY_OPEN] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_ARRAY_CLOSE] = JSON_PARSER_ACTION_APPEND,
+	},
+	[CSON_PARSER_STATE_ARRAY] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_CHAR,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_DIGIT,
+		[JSON_CHAR_CLASS_QUOTE] = JSON_PARSER_ACTION_ARRAY_QUOTE,
+		[JSON_CHAR_CLASS_MINUS] = JSON_PARSER_ACTION_NEGATIVE,
+		[JSON_CHAR_CLASS_OBJECT_OPEN] = JSON_PARSER_ACTION_NESTED_OBJECT,
+		[JSON_CHAR_CLASS_ARRAY_OPEN] = JSON_PARSER_ACTION_NESTED_ARRAY,
+		[JSON_CHAR_CLASS_ARRAY_CLOSE] = JSON_PARSER_ACTION_ARRAY_END,
+	},
+	[CSON_PARSER_STATE_STRING] = {
+		[JSON_CHAR_CLASS_OTHER] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_QUOTE] = JSON_PARSER_ACTION_STRING_END,
+		[JSON_CHAR_CLASS_BACKSLASH] = JSON_PARSER_ACTION_ESCAPE_START,
+		[JSON_CHAR_CLASS_MINUS] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_PERIOD] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_COLON] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_OBJECT_OPEN] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_OBJECT_CLOSE] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_ARRAY_OPEN] = JSON_PARSER_ACTION_APPEND,
+		[JSON_CHAR_CLASS_ARRAY_CLOSE] = JSON_PARSER_ACTION_APPEND,
+	},
+	[CSON_PARSER_STATE_I64] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NUMBER_END,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_CHAR,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_DIGIT,
+		[JSON_CHAR_CLASS_PERIOD] = JSON_PARSER_ACTION_FRACTION,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_NUMBER_COMMA,
+	},
+	[CSON_PARSER_STATE_U64] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NUMBER_END,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_CHAR,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_DIGIT,
+		[JSON_CHAR_CLASS_PERIOD] = JSON_PARSER_ACTION_FRACTION,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_NUMBER_COMMA,
+	},
+	[CSON_PARSER_STATE_F64] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NUMBER_END,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_CHAR,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_DIGIT,
+		[JSON_CHAR_CLASS_MINUS] = JSON_PARSER_ACTION_EXPONENT_SIGN,
+		[JSON_CHAR_CLASS_PERIOD] = JSON_PARSER_ACTION_PERIOD,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_NUMBER_COMMA,
+	},
+	[CSON_PARSER_STATE_BOOLEAN] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+	},
+	[CSON_PARSER_STATE_NULL] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_CHAR,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_NULL_COMMA,
+	},
+	[CSON_PARSER_STATE_ESCAPE] = {
+		[JSON_CHAR_CLASS_OTHER] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_ALPHA] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_DIGIT] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_QUOTE] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_BACKSLASH] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_MINUS] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_PERIOD] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_COLON] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_OBJECT_OPEN] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_OBJECT_CLOSE] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_ARRAY_OPEN] = JSON_PARSER_ACTION_ESCAPED,
+		[JSON_CHAR_CLASS_ARRAY_CLOSE] = JSON_PARSER_ACTION_ESCAPED,
+	},
+	[CSON_PARSER_STATE_EXPECT_END_OR_COMMA] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_WHITESPACE] = JSON_PARSER_ACTION_NONE,
+		[JSON_CHAR_CLASS_COMMA] = JSON_PARSER_ACTION_VALUE_SEPARATOR,
+		[JSON_CHAR_CLASS_OBJECT_CLOSE] = JSON_PARSER_ACTION_OBJECT_END,
+		[JSON_CHAR_CLASS_ARRAY_CLOSE] = JSON_PARSER_ACTION_ARRAY_END,
+	},
+	[CSON_PARSER_STATE_INVALID_CHARACTER] = {
+		[JSON_CHAR_CLASS_NUL] = JSON_PARSER_ACTION_NONE,
+	},
+};
+
+// GCC jumps straight from the table lookup to the action, every action ending in its
+// own indirect jump, define CSON_NO_COMPUTED_GOTO to get a plain switch instead.
+#if defined(__GNUC__) && !defined(CSON_NO_COMPUTED_GOTO)
+#define CSON_COMPUTED_GOTO
+#endif
+
+#ifdef CSON_COMPUTED_GOTO
+#define JSON_PARSER_DISPATCH(action) goto *json_parser_action_labels[action];
+#define JSON_PARSER_ACTION(name) json_parser_action_##name:
+#else
+#define JSON_PARSER_DISPATCH(action) switch (action)
+#define JSON_PARSER_ACTION(name) case JSON_PARSER_ACTION_##name:
+#endif // CSON_COMPUTED_GOTO
+
+// A ',' after a value: the next element may start, but a closing bracket may not.
+static int32_t json_parser_mark_trailing_comma(json_parser_t *parser) {
+	json_trace_dump(json_parser_flags_printf(parser->parser_flag));
+	if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_TRAILING_COMMA | CSON_PARSER_FLAG_FOUND_KEY_START | CSON_PARSER_FLAG_FOUND_KEY_END | CSON_PARSER_FLAG_FOUND_VALUE_START)) {
+		json_error("INVALID STATE");
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	parser->parser_flag |= CSON_PARSER_FLAG_FOUND_TRAILING_COMMA;
+	return 0;
+}
+
+// Whether a whole "null" literal starts at parser->pointer and ends before `end`.
+static inline bool json_parser_at_null(const json_parser_t *const parser, json_parser_state_t state, const char *const buf, ssize_t end) {
+	return (state == CSON_PARSER_STATE_ARRAY || (state == CSON_PARSER_STATE_OBJECT && (parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START)))
+		&& end - parser->pointer >= 4
+		&& memcmp(buf + parser->pointer, "null", 4) == 0;
+}
+
+int32_t json_parser_digest(json_parser_t *const parser, const char *const buf, ssize_t n, ssize_t padding) {
+	if (!parser || !buf || !parser->states || !parser->temporaries.objects || !parser->temporary_keys) return CSON_ERR_NULL_PTR;
+	if (n < 0) return CSON_ERR_INVALID_ARGUMENT;
+#ifdef CSON_COMPUTED_GOTO
+	static const void *const json_parser_action_labels[__JSON_PARSER_ACTION_MAX] = {
+		[JSON_PARSER_ACTION_ERROR] = &&json_parser_action_ERROR,
+		[JSON_PARSER_ACTION_NONE] = &&json_parser_action_NONE,
+		[JSON_PARSER_ACTION_APPEND] = &&json_parser_action_APPEND,
+		[JSON_PARSER_ACTION_CHAR] = &&json_parser_action_CHAR,
+		[JSON_PARSER_ACTION_DIGIT] = &&json_parser_action_DIGIT,
+		[JSON_PARSER_ACTION_ESCAPE_START] = &&json_parser_action_ESCAPE_START,
+		[JSON_PARSER_ACTION_ESCAPED] = &&json_parser_action_ESCAPED,
+		[JSON_PARSER_ACTION_OBJECT_QUOTE] = &&json_parser_action_OBJECT_QUOTE,
+		[JSON_PARSER_ACTION_ARRAY_QUOTE] = &&json_parser_action_ARRAY_QUOTE,
+		[JSON_PARSER_ACTION_KEY_END] = &&json_parser_action_KEY_END,
+		[JSON_PARSER_ACTION_STRING_END] = &&json_parser_action_STRING_END,
+		[JSON_PARSER_ACTION_KEY_SEPARATOR] = &&json_parser_action_KEY_SEPARATOR,
+		[JSON_PARSER_ACTION_NEGATIVE] = &&json_parser_action_NEGATIVE,
+		[JSON_PARSER_ACTION_EXPONENT_SIGN] = &&json_parser_action_EXPONENT_SIGN,
+		[JSON_PARSER_ACTION_FRACTION] = &&json_parser_action_FRACTION,
+		[JSON_PARSER_ACTION_PERIOD] = &&json_parser_action_PERIOD,
+		[JSON_PARSER_ACTION_NUMBER_END] = &&json_parser_action_NUMBER_END,
+		[JSON_PARSER_ACTION_NUMBER_COMMA] = &&json_parser_action_NUMBER_COMMA,
+		[JSON_PARSER_ACTION_NULL_COMMA] = &&json_parser_action_NULL_COMMA,
+		[JSON_PARSER_ACTION_VALUE_SEPARATOR] = &&json_parser_action_VALUE_SEPARATOR,
+		[JSON_PARSER_ACTION_ROOT_OBJECT] = &&json_parser_action_ROOT_OBJECT,
+		[JSON_PARSER_ACTION_NESTED_OBJECT] = &&json_parser_action_NESTED_OBJECT,
+		[JSON_PARSER_ACTION_OBJECT_END] = &&json_parser_action_OBJECT_END,
+		[JSON_PARSER_ACTION_ROOT_ARRAY] = &&json_parser_action_ROOT_ARRAY,
+		[JSON_PARSER_ACTION_NESTED_ARRAY] = &&json_parser_action_NESTED_ARRAY,
+		[JSON_PARSER_ACTION_ARRAY_END] = &&json_parser_action_ARRAY_END,
+	};
+#endif // CSON_COMPUTED_GOTO
+	json_parser_state_t current_state = CSON_PARSER_STATE_IDLE;
 	if (parser->state_count > 0) {
-		printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-		json_parser_pop_state(parser, &current_state);	
-	} 
-	int res = 0;
+		json_trace("Popping state");
+		json_parser_pop_state(parser, &current_state);
+	}
+	int res = json_structural_index_build(&parser->index, buf, n, padding);
+	if (res) {
+		json_error("Failed to index buffer due to error %d", res);
+		return res;
+	}
 	for (parser->pointer = 0; parser->pointer < n; ++parser->pointer) {
-		printf("state stack:\n");
-		json_parser_print_state(parser);
-		printf("current state: %s\n", get_state_name(current_state));
-		char ch = parser->buf[parser->pointer];
-		printf("current char \"%c\" at index %lld\n", ch, parser->pointer);
-		printf("flags:\n");
-		json_parser_flags_printf(parser->parser_flag);
-		if (isalpha(ch)) {
-			res = json_parser_handle_char(parser, &current_state, ch);
-			if (res) {
-				printf(LOG_STRING"got error %d\n", __FILE__, __LINE__, res);
-				return res;
+		if (current_state == CSON_PARSER_STATE_STRING || current_state == CSON_PARSER_STATE_KEY) {
+			// Only a quote or a backslash needs the state machine, everything up to the
+			// next indexed one is plain content and goes in as one run.
+			ssize_t next = json_structural_index_next_quote(&parser->index, buf, parser->pointer);
+			ssize_t run = (next < 0 ? n : next) - parser->pointer;
+			if (run > 0) {
+				res = json_parser_append_run(parser, json_parser_current_string(parser, current_state), buf + parser->pointer, run);
+				if (res) return res;
+				parser->pointer += run;
 			}
+			if (parser->pointer >= n) break;
 		}
-		else if (isdigit(ch)) {
-			res = json_parser_handle_digit(parser, &current_state, ch);
-			if (res) {
-				printf(LOG_STRING"got error %d\n", __FILE__, __LINE__, res);
-				return res;
+		// Between tokens the next thing that matters is the next indexed position, in
+		// front of it there is only whitespace, skipped in one go, and at most one scalar.
+		if (current_state == CSON_PARSER_STATE_OBJECT || current_state == CSON_PARSER_STATE_ARRAY
+			|| current_state == CSON_PARSER_STATE_EXPECT_END_OR_COMMA || current_state == CSON_PARSER_STATE_IDLE
+		) {
+			ssize_t next = json_structural_index_next(&parser->index, parser->pointer);
+			if (next < 0) next = n;
+			if (next > parser->pointer) {
+				if (json_char_classes[(unsigned char)buf[parser->pointer]] == JSON_CHAR_CLASS_WHITESPACE) {
+					parser->pointer += json_simd_skip_whitespace(buf + parser->pointer, next - parser->pointer);
+					if (parser->pointer >= n) break;
+				}
+				// A literal that ends before the next position is taken in one step,
+				// the NULL state only sees the ones split across windows.
+				if (parser->pointer < next && json_parser_at_null(parser, current_state, buf, next)) {
+					res = json_parser_push_state(parser, current_state);
+					if (res) return res;
+					res = json_parser_push_null(parser);
+					if (res) return res;
+					current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
+					parser->pointer += 3;
+					continue;
+				}
 			}
 		}
-		else {
-			switch (ch) {
-				case '\"': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_ESCAPE: {
-							printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-							res = json_parser_pop_state(parser, &current_state);
-							printf("Resulting state: %s\n", get_state_name(current_state));
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to pop state due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-							switch (current_state) {
-								case CSON_PARSER_STATE_STRING: {
-									json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-									res = json_string_append_char(str, ch);
-									if (res) {
-										return res;
-									}
-								} break;
-								case CSON_PARSER_STATE_KEY: {
-									json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-									res = json_string_append_char(str, ch);
-									if (res) {
-										return res;
-									}
-								} break;
-								default: {
-									fprintf(stderr, "Unreachable state reached.\n");
-									exit(-1);
-									return CSON_PARSER_STATE_INVALID_CHARACTER;
-								} break;
-							}
-						} break;
-						case CSON_PARSER_STATE_OBJECT: {
-							if (!(parser->parser_flag & (CSON_PARSER_FLAG_FOUND_KEY_START | CSON_PARSER_FLAG_FOUND_KEY_END | CSON_PARSER_FLAG_FOUND_VALUE_START))) {
-								printf("Pushing key starting at index %lld\n", parser->pointer);
-								res = json_parser_push_key(parser);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push key into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_TRAILING_COMMA) | CSON_PARSER_FLAG_FOUND_KEY_START;
-								printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-								res = json_parser_push_state(parser, current_state);
-								if (res) {
-									return res;
-								}
-
-								current_state = CSON_PARSER_STATE_KEY;
-								continue;
-							}
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_KEY_END) {
-								fprintf(stderr, LOG_STRING"Found invalid character \'\"\' at index %lld when parsing object values\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER; 
-							}
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START) {
-								printf("Pushing string starting at index %lld\n", parser->pointer);
-								json_value_t val = {
-									.value_type = JSON_OBJECT_TYPE_STRING,
-									.string = {
-										.length = 0,
-										.size = 0,
-										.buf = NULL
-									}
-								};
-								res = json_parser_push_temporary(parser, &val, false);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push string into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-								res = json_parser_push_state(parser, current_state);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push state into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_STRING_START;
-								current_state = CSON_PARSER_STATE_STRING;
-								continue;
-							}
-						} break;
-						case CSON_PARSER_STATE_ARRAY: {
-							parser->parser_flag &= ~CSON_PARSER_FLAG_FOUND_TRAILING_COMMA;
-							if (!(parser->parser_flag & CSON_PARSER_FLAG_FOUND_STRING_START)) {
-								json_value_t val = {
-									.value_type = JSON_OBJECT_TYPE_STRING,
-									.string = {
-										.buf = NULL
-									}
-								};
-								res = json_parser_push_temporary(parser, &val, false);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push string into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-								res = json_parser_push_state(parser, current_state);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push state into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								current_state = CSON_PARSER_STATE_STRING;
-								parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_STRING_START;
-							} else {
-								fprintf(stderr, LOG_STRING"Found invalid character \'\"\' at index %lld when parsing array values\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-						} break;
-						case CSON_PARSER_STATE_KEY: {
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_KEY_START) {
-								parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_KEY_START) | CSON_PARSER_FLAG_FOUND_KEY_END;
-								printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-								res = json_parser_pop_state(parser, &current_state);
-								if (res) {
-									return res;
-								}
-								continue;
-							} else {
-								fprintf(stderr, LOG_STRING"Found invalid character \'\"\' at index %lld when parsing key\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_STRING_START) {
-								current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-								printf("Expecting comma or end\n");
-								parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_STRING_START);
-							} else {
-								fprintf(stderr, LOG_STRING"Found invalid character \'\"\' at index %lld when parsing string\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character \'\"\' at index %lld when parsing (state: %d)\n", __FILE__, __LINE__, parser->pointer, current_state);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+		json_trace("state stack:");
+		json_trace_dump(json_parser_print_state(parser));
+		json_trace("current state: %s", get_state_name(current_state));
+		char ch = buf[parser->pointer];
+		json_trace("current char \"%c\" at index %lld", ch, parser->pointer);
+		json_trace_dump(json_parser_flags_printf(parser->parser_flag));
+		JSON_PARSER_DISPATCH(json_parser_transitions[current_state][json_char_classes[(unsigned char)ch]]) {
+			JSON_PARSER_ACTION(ERROR) {
+				if ((ch == '}' || ch == ']') && (parser->parser_flag & CSON_PARSER_FLAG_FOUND_TRAILING_COMMA)) {
+					json_error("Found trailing comma");
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_error("Found illegal \'%c\' character at index %lld (state: %s)", ch, parser->pointer, get_state_name(current_state));
+				return CSON_PARSER_STATE_INVALID_CHARACTER;
+			}
+			JSON_PARSER_ACTION(NONE) {
+				continue;
+			}
+			JSON_PARSER_ACTION(APPEND) {
+				res = json_parser_append_char(parser, json_parser_current_string(parser, current_state), ch);
+				if (res) return res;
+				continue;
+			}
+			JSON_PARSER_ACTION(CHAR) {
+				res = json_parser_handle_char(parser, &current_state, ch);
+				if (res) {
+					json_trace("got error %d", res);
+					return res;
+				}
+				continue;
+			}
+			JSON_PARSER_ACTION(DIGIT) {
+				res = json_parser_handle_digit(parser, &current_state, ch);
+				if (res) {
+					json_trace("got error %d", res);
+					return res;
+				}
+				if (current_state == CSON_PARSER_STATE_U64 || current_state == CSON_PARSER_STATE_I64) {
+					res = json_parser_scan_integer(parser, current_state, buf, n);
+					if (res) return res;
+				}
+				continue;
+			}
+			JSON_PARSER_ACTION(ESCAPE_START) {
+				// An escape that ends inside this buffer is decoded on the spot, one cut off
+				// by its end is collected in parser->escape until the rest arrives.
+				ssize_t length = json_parser_escape_length(buf + parser->pointer, n - parser->pointer);
+				if (length) {
+					res = json_parser_append_escape(parser, json_parser_current_string(parser, current_state), buf + parser->pointer, length);
+					if (res) return res;
+					parser->pointer += length - 1;
+					continue;
+				}
+				json_trace("Entering escape mode");
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) {
+					json_error("Failed to push state into parser due to error %d", res);
+					return res;
+				}
+				parser->escape_length = n - parser->pointer;
+				memcpy(parser->escape, buf + parser->pointer, parser->escape_length);
+				parser->pointer = n - 1;
+				current_state = CSON_PARSER_STATE_ESCAPE;
+				continue;
+			}
+			JSON_PARSER_ACTION(ESCAPED) {
+				parser->escape[parser->escape_length++] = ch;
+				ssize_t length = json_parser_escape_length(parser->escape, parser->escape_length);
+				if (!length) continue;
+				json_trace("Popping state");
+				res = json_parser_pop_state(parser, &current_state);
+				json_trace("Resulting state: %s", get_state_name(current_state));
+				if (res) {
+					json_error("Failed to pop state due to error %d", res);
+					return res;
+				}
+				res = json_parser_append_escape(parser, json_parser_current_string(parser, current_state), parser->escape, length);
+				if (res) return res;
+				parser->escape_length = 0;
+				continue;
+			}
+			JSON_PARSER_ACTION(OBJECT_QUOTE) {
+				if (!(parser->parser_flag & (CSON_PARSER_FLAG_FOUND_KEY_START | CSON_PARSER_FLAG_FOUND_KEY_END | CSON_PARSER_FLAG_FOUND_VALUE_START))) {
+					json_trace("Pushing key starting at index %lld", parser->pointer);
+					res = json_parser_push_key(parser, buf + parser->pointer + 1);
+					if (res) {
+						json_error("Failed to push key into parser due to error %d", res);
+						return res;
+					}
+					parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_TRAILING_COMMA) | CSON_PARSER_FLAG_FOUND_KEY_START;
+					json_trace("Pushing state");
+					res = json_parser_push_state(parser, current_state);
+					if (res) {
+						return res;
 					}
-				} break;
-				case '-': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							int res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							int res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_OBJECT: {
-							if (!(parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START)) {
-								fprintf(stderr, "Found illegal \'-\' at index %lld\n", parser->pointer);
-								exit(-1);
-							}
-							json_value_t val = {
-								.value_type = JSON_OBJECT_TYPE_NUMBER,
-								.number = {
-									.num_type = JSON_NUMBER_TYPE_I64,
-									.i64 = 0
-								}
-							};
-							parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_SIGN;
-							json_parser_push_temporary(parser, &val, false);
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							json_parser_push_state(parser, current_state);
-							current_state = CSON_PARSER_STATE_I64;
-						} break;
-						case CSON_PARSER_STATE_ARRAY: {
-							json_value_t val = {
-								.value_type = JSON_OBJECT_TYPE_NUMBER,
-								.number = {
-									.num_type = JSON_NUMBER_TYPE_I64,
-									.i64 = 0
-								}
-							};
-							parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_SIGN;
-							json_parser_push_temporary(parser, &val, false);
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							json_parser_push_state(parser, current_state);
-							current_state = CSON_PARSER_STATE_I64;
-						} break;
-						case CSON_PARSER_STATE_F64: {
-							json_parser_flags_printf(parser->parser_flag);
-							// Parse '-' after 'e'
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_SIGN) {
-								if ((parser->parser_flag & (CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT)) == CSON_PARSER_FLAG_FOUND_EXPONENT && !parser->found_number_after_exponent) {
-									printf("Found negative sign after exponent.\n");
-									parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_EXPONENT) | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT;
-									break;
-								} else {
-									fprintf(stderr, LOG_STRING"Found duplicate \'-\' characters at index %lld when parsing number.\n", __FILE__, __LINE__, parser->pointer);
-									return CSON_PARSER_STATE_INVALID_CHARACTER;
-								}
-							} else {
-								if ((parser->parser_flag & CSON_PARSER_FLAG_FOUND_EXPONENT) && !parser->found_number_after_exponent) {
-									printf("Found negative sign after exponent.\n");
-									parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_EXPONENT) | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT;
-									break;
-								} else {
-									fprintf(stderr, LOG_STRING"Found invalid \'-\' characters at index %lld when parsing number.\n", __FILE__, __LINE__, parser->pointer);
-									return CSON_PARSER_STATE_INVALID_CHARACTER;
-								}
-							}
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character \'-\' at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						}	
+					current_state = CSON_PARSER_STATE_KEY;
+					continue;
+				}
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_KEY_END) {
+					json_error("Found invalid character \'\"\' at index %lld when parsing object values", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START) {
+					json_trace("Pushing string starting at index %lld", parser->pointer);
+					json_value_t val = {
+						.value_type = JSON_OBJECT_TYPE_STRING
+					};
+					parser->string = json_parser_string_start(parser, buf + parser->pointer + 1);
+					res = json_parser_push_temporary(parser, &val, false);
+					if (res) {
+						json_error("Failed to push string into parser due to error %d", res);
+						return res;
 					}
-				} break;
-				case '.': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							int res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							int res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_I64: {
-							printf(LOG_STRING"Found period at index %lld, converting number to double.\n", __FILE__, __LINE__, parser->pointer);
-							current_state = CSON_PARSER_STATE_F64;
-							parser->parser_flag |= CSON_PARSER_FLAG_FOUND_PERIOD;
-							parser->exponent = 0;
-							double f = parser->temporaries.objects[parser->temporaries.length - 1].number.i64;
-							parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
-							parser->temporaries.objects[parser->temporaries.length - 1].number.num_type = JSON_NUMBER_TYPE_F64;
-						} break;
-						case CSON_PARSER_STATE_U64: {
-							printf(LOG_STRING"Found period at index %lld, converting number to double.\n", __FILE__, __LINE__, parser->pointer);
-							current_state = CSON_PARSER_STATE_F64;
-							parser->parser_flag |= CSON_PARSER_FLAG_FOUND_PERIOD;
-							parser->exponent = 0;
-							double f = parser->temporaries.objects[parser->temporaries.length - 1].number.u64;
-							parser->temporaries.objects[parser->temporaries.length - 1].number.f64 = f;
-							parser->temporaries.objects[parser->temporaries.length - 1].number.num_type = JSON_NUMBER_TYPE_F64;
-						} break;
-						case CSON_PARSER_STATE_F64: {
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_PERIOD) {
-								fprintf(stderr, LOG_STRING"Found duplicate \'.\' characters at index %lld when parsing double.\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-							if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT)) {
-								fprintf(stderr, LOG_STRING"Found period after exponent symbol at index %lld when parsing double\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-							printf(LOG_STRING"Found period at index %lld, setting period flag.\n", __FILE__, __LINE__, parser->pointer);
-							parser->exponent = 0;
-							parser->parser_flag |= CSON_PARSER_FLAG_FOUND_PERIOD;
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character \'.\' at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						}	
+					json_trace("Pushing state");
+					res = json_parser_push_state(parser, current_state);
+					if (res) {
+						json_error("Failed to push state into parser due to error %d", res);
+						return res;
 					}
-				} break;
-				case ':': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_OBJECT: {
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_KEY_END) {
-								parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_KEY_END) | CSON_PARSER_FLAG_FOUND_VALUE_START;
-								break;
-							} else {
-								fprintf(stderr, LOG_STRING"Found unaccounted \':\' character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
+					parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_STRING_START;
+					current_state = CSON_PARSER_STATE_STRING;
+				}
+				continue;
+			}
+			JSON_PARSER_ACTION(ARRAY_QUOTE) {
+				parser->parser_flag &= ~CSON_PARSER_FLAG_FOUND_TRAILING_COMMA;
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_STRING_START) {
+					json_error("Found invalid character \'\"\' at index %lld when parsing array values", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_value_t val = {
+					.value_type = JSON_OBJECT_TYPE_STRING
+				};
+				parser->string = json_parser_string_start(parser, buf + parser->pointer + 1);
+				res = json_parser_push_temporary(parser, &val, false);
+				if (res) {
+					json_error("Failed to push string into parser due to error %d", res);
+					return res;
+				}
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) {
+					json_error("Failed to push state into parser due to error %d", res);
+					return res;
+				}
+				current_state = CSON_PARSER_STATE_STRING;
+				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_STRING_START;
+				continue;
+			}
+			JSON_PARSER_ACTION(KEY_END) {
+				if (!(parser->parser_flag & CSON_PARSER_FLAG_FOUND_KEY_START)) {
+					json_error("Found invalid character \'\"\' at index %lld when parsing key", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_parser_string_end(parser, &parser->temporary_keys[parser->key_count - 1]);
+				if (parser->intern) {
+					res = json_parser_intern_key(parser, &parser->temporary_keys[parser->key_count - 1]);
+					if (res) return res;
+				} else if (parser->options & CSON_PARSER_OPTION_EXACT_SIZE) {
+					res = json_parser_fit_key(parser, &parser->temporary_keys[parser->key_count - 1]);
+					if (res) return res;
+				}
+				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_KEY_START) | CSON_PARSER_FLAG_FOUND_KEY_END;
+				json_trace("Popping state");
+				res = json_parser_pop_state(parser, &current_state);
+				if (res) {
+					return res;
+				}
+				continue;
+			}
+			JSON_PARSER_ACTION(STRING_END) {
+				if (!(parser->parser_flag & CSON_PARSER_FLAG_FOUND_STRING_START)) {
+					json_error("Found invalid character \'\"\' at index %lld when parsing string", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_parser_string_end(parser, &parser->string);
+				res = json_value_set_string(&parser->temporaries.objects[parser->temporaries.length - 1], &parser->string, parser->allocator);
+				if (res) return res;
+				current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
+				json_trace("Expecting comma or end");
+				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_STRING_START);
+				continue;
+			}
+			JSON_PARSER_ACTION(KEY_SEPARATOR) {
+				if (!(parser->parser_flag & CSON_PARSER_FLAG_FOUND_KEY_END)) {
+					json_error("Found unaccounted \':\' character at index %lld", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_KEY_END) | CSON_PARSER_FLAG_FOUND_VALUE_START;
+				continue;
+			}
+			JSON_PARSER_ACTION(NEGATIVE) {
+				if (current_state == CSON_PARSER_STATE_OBJECT && !(parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START)) {
+					json_error("Found illegal \'-\' at index %lld", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_value_t val = {
+					.value_type = JSON_OBJECT_TYPE_NUMBER,
+					.num_type = JSON_NUMBER_TYPE_I64,
+					.i64 = 0
+				};
+				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_VALUE_START) | CSON_PARSER_FLAG_FOUND_SIGN;
+				res = json_parser_push_temporary(parser, &val, false);
+				if (res) return res;
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) return res;
+				current_state = CSON_PARSER_STATE_I64;
+				continue;
+			}
+			JSON_PARSER_ACTION(EXPONENT_SIGN) {
+				json_trace_dump(json_parser_flags_printf(parser->parser_flag));
+				// Only valid right after 'e', before any exponent digit.
+				if ((parser->parser_flag & (CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT)) != CSON_PARSER_FLAG_FOUND_EXPONENT || parser->found_number_after_exponent) {
+					json_error("Found invalid \'-\' characters at index %lld when parsing number.", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_trace("Found negative sign after exponent.");
+				parser->parser_flag = (parser->parser_flag & ~CSON_PARSER_FLAG_FOUND_EXPONENT) | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT;
+				continue;
+			}
+			JSON_PARSER_ACTION(FRACTION) {
+				json_trace("Found period at index %lld, converting number to double.", parser->pointer);
+				json_value_t *number = &parser->temporaries.objects[parser->temporaries.length - 1];
+				uint64_t magnitude = current_state == CSON_PARSER_STATE_I64 ? 0 - (uint64_t)number->i64 : number->u64;
+				current_state = CSON_PARSER_STATE_F64;
+				parser->parser_flag |= CSON_PARSER_FLAG_FOUND_PERIOD;
+				parser->exponent = 0;
+				res = json_parser_number_start(parser, magnitude);
+				if (res) return res;
+				number->num_type = JSON_NUMBER_TYPE_F64;
+				continue;
+			}
+			JSON_PARSER_ACTION(PERIOD) {
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_PERIOD) {
+					json_error("Found duplicate \'.\' characters at index %lld when parsing double.", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT)) {
+					json_error("Found period after exponent symbol at index %lld when parsing double", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_trace("Found period at index %lld, setting period flag.", parser->pointer);
+				parser->exponent = 0;
+				parser->parser_flag |= CSON_PARSER_FLAG_FOUND_PERIOD;
+				continue;
+			}
+			JSON_PARSER_ACTION(NUMBER_END) {
+				// Whitespace ends the number, a later ',' or '}' no longer sees its flags.
+				res = validate_number(parser);
+				if (res) return res;
+				current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
+				json_trace("Expecting comma or end");
+				continue;
+			}
+			JSON_PARSER_ACTION(NUMBER_COMMA) {
+				res = validate_number(parser);
+				if (res) {
+					return res;
+				}
+				json_trace("Popping state");
+				res = json_parser_pop_state(parser, &current_state);
+				if (res) return res;
+				parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
+				parser->exponent = 0;
+				res = json_parser_mark_trailing_comma(parser);
+				if (res) return res;
+				continue;
+			}
+			JSON_PARSER_ACTION(NULL_COMMA) {
+				res = json_parser_mark_trailing_comma(parser);
+				if (res) return res;
+				continue;
+			}
+			JSON_PARSER_ACTION(VALUE_SEPARATOR) {
+				json_trace("Popping state");
+				res = json_parser_pop_state(parser, &current_state);
+				if (res) return res;
+				continue;
+			}
+			JSON_PARSER_ACTION(ROOT_OBJECT) {
+				json_object_t *object = json_allocator_malloc(parser->allocator, sizeof(json_object_t));
+				if (!object) {
+					json_error("Failed to initialize first object");
+					return CSON_ERR_ALLOC;
+				}
+				*object = (json_object_t){
+					.allocator = json_allocator_resolve(parser->allocator)
+				};
+				json_value_t val = {
+					.object = object
+				};
+				parser->value = val;
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) {
+					return res;
+				}
+				current_state = CSON_PARSER_STATE_OBJECT;
+				continue;
+			}
+			JSON_PARSER_ACTION(NESTED_OBJECT) {
+				if (current_state == CSON_PARSER_STATE_OBJECT && !(parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START)) {
+					json_error("Found \'{\' at index %lld without key", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				json_object_t *object = json_allocator_malloc(parser->allocator, sizeof(json_object_t));
+				if (!object) {
+					json_error("Failed to initialize first object");
+					return CSON_ERR_ALLOC;
+				}
+				*object = (json_object_t){
+					.allocator = json_allocator_resolve(parser->allocator)
+				};
+				res = json_parser_push_depth(parser);
+				if (res) {
+					return res;
+				}
+				json_value_t val = {
+					.object = object
+				};
+				res = json_parser_push_temporary(parser, &val, false);
+				if (res) {
+					json_error("Failed to push temporary into parser due to error %d", res);
+					return res;
+				}
+				parser->parser_flag &= ~CSON_PARSER_FLAG_FOUND_VALUE_START;
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) {
+					return res;
+				}
+				current_state = CSON_PARSER_STATE_OBJECT;
+				continue;
+			}
+			JSON_PARSER_ACTION(OBJECT_END) {
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_TRAILING_COMMA) {
+					json_error("Found trailing comma");
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				if (current_state == CSON_PARSER_STATE_EXPECT_END_OR_COMMA) {
+					json_trace("Popping state");
+					json_parser_pop_state(parser, NULL);
+				}
+				ssize_t index = -1;
+#if CSON_TRACE_LEVEL >= CSON_TRACE_LEVEL_TRACE
+				for (ssize_t i = 0; i < parser->key_count; ++i) {
+					json_trace("key %lld: \"%.*s\"", i, (int)parser->temporary_keys[i].length, json_string_data(&parser->temporary_keys[i]));
+				}
+				json_trace("temporaries:");
+				for (ssize_t i = 0; i < parser->temporaries.length; ++i) {
+					printf("i: %lld, ", i);
+					json_value_printf(&parser->temporaries.objects[i], 0, true);
+					printf("\n");
+				}
+				for (ssize_t j = 0; j < parser->depth_count; ++j) {
+					json_trace("depth %lld: %lld", j, parser->depth[j]);
+				}
+#endif // CSON_TRACE_LEVEL
+				if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_STRING_START | CSON_PARSER_FLAG_FOUND_KEY_END | CSON_PARSER_FLAG_FOUND_KEY_START)) {
+					json_trace_dump(json_parser_flags_printf(parser->parser_flag));
+					json_error("Found unterminated key");
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
 
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found illegal \':\' character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							fprintf(stderr, "current state: %s\n", get_state_name(current_state));
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+				json_parser_pop_depth(parser, &index);
+				if (index >= 0) {
+					json_trace("index: %lld, type: %d", index, parser->temporaries.objects[index].value_type);
+					if (parser->temporaries.objects[index].value_type != JSON_OBJECT_TYPE_OBJECT) {
+						json_error("Found illegal \'}\' on index %lld", index);
+						return CSON_PARSER_STATE_INVALID_CHARACTER;
 					}
-				} break;
-				case '{': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_IDLE: {
-							json_object_t *object = debug_malloc(sizeof(json_object_t));
-							if (!object) {
-								fprintf(stderr, LOG_STRING"Failed to initialize first object\n", __FILE__, __LINE__);
-								return CSON_ERR_ALLOC;
-							}
-							res = json_object_init(object, 8);
-							if (res) {
-								return res;
-							}
-							json_value_t val = {
-								.object = object
-							};
-							parser->value = val;
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							res = json_parser_push_state(parser, current_state);
-							if (res) {
-								return res;
-							}
-							current_state = CSON_PARSER_STATE_OBJECT;
-						} break;
-						case CSON_PARSER_STATE_OBJECT: {
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START) {
-								json_object_t *object = debug_malloc(sizeof(json_object_t));
-								if (!object) {
-									fprintf(stderr, LOG_STRING"Failed to initialize first object\n", __FILE__, __LINE__);
-									return CSON_ERR_ALLOC;
-								}
-								res = json_object_init(object, 8);
-								if (res) {
-									return res;
-								}
-								res = json_parser_push_depth(parser);
-								if (res) {
-									return res;
-								}
-								// printf("depth:\n");
-								// for (ssize_t j = 0; j < parser->depth_count; ++j) {
-								// 	printf("%lld ", parser->depth[j]);
-								// }
-								// printf("\n");
-								json_value_t val = {
-									.object = object
-								};
-								res = json_parser_push_temporary(parser, &val, false);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push temporary into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								parser->parser_flag &= ~CSON_PARSER_FLAG_FOUND_VALUE_START;
-								printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-								res = json_parser_push_state(parser, current_state);
-								if (res) {
-									return res;
-								}
-								current_state = CSON_PARSER_STATE_OBJECT;
-								break;
-							} else {
-								fprintf(stderr, LOG_STRING"Found \'{\' at index %lld without key\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-						} break;
-						case CSON_PARSER_STATE_ARRAY: {
-							res = json_parser_push_depth(parser);
-							if (res) {
-								return res;
-							}
-							json_object_t *object = debug_malloc(sizeof(json_object_t));
-							if (!object) {
-								fprintf(stderr, LOG_STRING"Failed to initialize first object\n", __FILE__, __LINE__);
-								return CSON_ERR_ALLOC;
-							}
-							res = json_object_init(object, 8);
-							if (res) {
-								return res;
-							}
-							json_value_t val = {
-								.object = object
-							};
-							res = json_parser_push_temporary(parser, &val, false);
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push temporary into parser due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-							parser->parser_flag &= ~CSON_PARSER_FLAG_FOUND_VALUE_START;
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							res = json_parser_push_state(parser, current_state);
-							if (res) {
-								return res;
-							}
-							current_state = CSON_PARSER_STATE_OBJECT;
-						} break;
-
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
+					if (parser->temporaries.length > 0
+						&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
+					) {
+						res = validate_number(parser);
+						if (res) {
+							json_trace("number invalidated");
+							return res;
 						}
 					}
-				} break;
-				case '}': {
-					if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_TRAILING_COMMA) {
-						fprintf(stderr, LOG_STRING"Found trailing comma\n", __FILE__, __LINE__);
+					json_object_t *obj = parser->temporaries.objects[index].object;
+					ssize_t j, k;
+					ssize_t new_key_length = parser->key_count - (parser->temporaries.length - index) + 1;
+					json_trace("new_key_length: %lld", new_key_length);
+					if (new_key_length < 0) {
+						json_error("Found object value without key");
 						return CSON_PARSER_STATE_INVALID_CHARACTER;
 					}
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {
-							printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-							json_parser_pop_state(parser, NULL);
-						} __attribute__((fallthrough));
-						case CSON_PARSER_STATE_OBJECT: 
-						{
-							ssize_t index = -1;
-							printf("keys:\n");
-							for (ssize_t i = 0; i < parser->key_count; ++i) {
-								printf("i: %lld, ", i);
-								json_string_printf(&parser->temporary_keys[i]);
-								printf("\n");
-							}
-							printf("temporaries:\n");
-							for (ssize_t i = 0; i < parser->temporaries.length; ++i) {
-								printf("i: %lld, ", i);
-								json_value_printf(&parser->temporaries.objects[i], 0, true);
-								printf("\n");
-							}
-							printf("Depth:\n");
-							for (ssize_t j = 0; j < parser->depth_count; ++j) {
-								printf("%lld ", parser->depth[j]);
-							}
-							printf("\n");
-							if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_STRING_START | CSON_PARSER_FLAG_FOUND_KEY_END | CSON_PARSER_FLAG_FOUND_KEY_START)) {
-								json_parser_flags_printf(parser->parser_flag);
-								printf(LOG_STRING"Found unterminated key\n", __FILE__, __LINE__);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-							
-							json_parser_pop_depth(parser, &index);
-							if (index >= 0) {
-								printf("index: %lld, type: %d\n", index, parser->temporaries.objects[index].value_type);
-								if (parser->temporaries.objects[index].value_type != JSON_OBJECT_TYPE_OBJECT) {
-									fprintf(stderr, LOG_STRING"Found illegal \'}\' on index %lld\n", __FILE__, __LINE__, index);
-									return CSON_PARSER_STATE_INVALID_CHARACTER;
-								}
-								if (parser->temporaries.length > 0 
-									&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
-								) {
-									res = validate_number(parser);
-									if (res) {
-										printf(LOG_STRING"number invalidated\n", __FILE__, __LINE__);
-										return res;
-									}
-								} 
-								json_object_t *obj = parser->temporaries.objects[index].object;
-								ssize_t j, k;
-								ssize_t new_key_length = parser->key_count - (parser->temporaries.length - index) + 1;
-								printf("new_key_length: %lld\n", new_key_length);
-								assert(new_key_length >= 0);
-								for (j = index + 1, k = new_key_length; k < parser->key_count && j < parser->temporaries.length; ++j, ++k) {
-									// printf("moving key to object\n");
-									// json_string_printf(&parser->temporary_keys[k]);
-									// printf("\nmoving value to object\n");
-									// json_value_printf(&parser->temporaries.objects[j], 0, true);
-									// printf("\n");
-									json_object_move_value(obj, &parser->temporary_keys[k], &parser->temporaries.objects[j]);
-									parser->temporary_keys[k] = (json_string_t){};
-									parser->temporaries.objects[j] = (json_value_t){};
-								}
-								printf("new length: %lld\n", index);
-								parser->temporaries.length = index + 1;
-								parser->key_count = new_key_length;
-							} else {
-								if (parser->value.value_type != JSON_OBJECT_TYPE_OBJECT) {
-									fprintf(stderr, LOG_STRING"Failed to find object\n", __FILE__, __LINE__);
-									exit(-1);
-								} else {
-									if (parser->temporaries.length > 0 
-										&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
-									) {
-										res = validate_number(parser);
-										if (res) {
-											printf(LOG_STRING"number invalidated\n", __FILE__, __LINE__);
-											return res;
-										}
-									} 
-									index++;
-									for (ssize_t j = 0, k = 0; j < parser->temporaries.length && k < parser->key_count; ++j, ++k) {
-										printf("moving key to object\n");
-										json_string_printf(&parser->temporary_keys[k]);
-										printf("\n");
-										printf("moving value to object\n");
-										json_value_printf(&parser->temporaries.objects[j], 0, true);
-										printf("\n");
-										json_object_move_value(parser->value.object, &parser->temporary_keys[k], &parser->temporaries.objects[j]);
-										parser->temporary_keys[k] = (json_string_t){};
-										parser->temporaries.objects[j] = (json_value_t){};
-									}
-									printf("new length: %lld\n", index);
-									parser->temporaries.length = 0;
-									parser->key_count = 0;
-									printf("object:\n");
-									json_object_printf(parser->value.object, 0, true);
-									printf("\n");
-								}
-							}
-							current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-							parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						}
+					res = json_parser_size_object(parser, obj, parser->key_count - new_key_length);
+					if (res) return res;
+					for (j = index + 1, k = new_key_length; k < parser->key_count && j < parser->temporaries.length; ++j, ++k) {
+						res = json_parser_move_member(parser, obj, &parser->temporary_keys[k], &parser->temporaries.objects[j]);
+						if (res) return res;
 					}
-				} break;
-				case '[': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_IDLE: {
-							json_array_t *array = debug_malloc(sizeof(json_array_t));
-							if (!array) {
-								fprintf(stderr, LOG_STRING"Failed to initialize first array\n", __FILE__, __LINE__);
-								return CSON_ERR_ALLOC;
-							}
-							res = json_array_init(array, 8);
-							if (res) {
-								return res;
-							}
-							json_value_t val = {
-								.value_type = JSON_OBJECT_TYPE_ARRAY,
-								.array = array
-							};
-							parser->value = val;
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							res = json_parser_push_state(parser, current_state);
-							if (res) {
-								return res;
-							}
-							current_state = CSON_PARSER_STATE_ARRAY;
-						} break;
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_OBJECT: {
-							if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START) {
-								res = json_parser_push_depth(parser);
-								if (res) {
-									return res;
-								}
-								json_array_t *array = debug_malloc(sizeof(json_array_t));
-								res = json_array_init(array, 8);
-								if (res) return res;
-								json_value_t val = {
-									.value_type = JSON_OBJECT_TYPE_ARRAY,
-									.array = array
-								};
-								res = json_parser_push_temporary(parser, &val, false);
-								if (res) {
-									fprintf(stderr, LOG_STRING"Failed to push temporary into parser due to error %d\n", __FILE__, __LINE__, res);
-									return res;
-								}
-								printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-								res = json_parser_push_state(parser, current_state);
-								if (res) {
-									return res;
-								}
-								current_state = CSON_PARSER_STATE_ARRAY;
-								break;
-							} else {
-								fprintf(stderr, LOG_STRING"Found \'[\' at index %lld without key\n", __FILE__, __LINE__, parser->pointer);
-								return CSON_PARSER_STATE_INVALID_CHARACTER;
-							}
-						} break;
-						case CSON_PARSER_STATE_ARRAY: {
-							res = json_parser_push_depth(parser);
-							if (res) {
-								return res;
-							}
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							res = json_parser_push_state(parser, current_state);
-							if (res) {
-								return res;
-							}
-							current_state = CSON_PARSER_STATE_ARRAY;
-							json_array_t *array = debug_malloc(sizeof(json_array_t));
-							res = json_array_init(array, 8);
-							if (res) return res;
-							json_value_t val = {
-								.value_type = JSON_OBJECT_TYPE_ARRAY,
-								.array = array
-							};
-							res = json_parser_push_temporary(parser, &val, false);
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push temporary into parser due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-							break;
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						}
-					}
-				} break;
-				case ']': {
-					if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_TRAILING_COMMA) {
-						fprintf(stderr, LOG_STRING"Found trailing comma\n", __FILE__, __LINE__);
+					json_trace("new length: %lld", index);
+					parser->temporaries.length = index + 1;
+					parser->key_count = new_key_length;
+				} else {
+					if (parser->value.value_type != JSON_OBJECT_TYPE_OBJECT) {
+						json_error("Failed to find object");
 						return CSON_PARSER_STATE_INVALID_CHARACTER;
 					}
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {
-							printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-							json_parser_pop_state(parser, NULL);
-						} __attribute__((fallthrough));
-						case CSON_PARSER_STATE_ARRAY: {
-							ssize_t index = -1;
-							printf("temporaries:\n");
-							for (ssize_t i = 0; i < parser->temporaries.length; ++i) {
-								printf("i: %lld\n", i);
-								json_value_printf(&parser->temporaries.objects[i], 0, true);
-								printf("\n");
-							}
-							printf("Depth:\n");
-							for (ssize_t j = 0; j < parser->depth_count; ++j) {
-								printf("%lld ", parser->depth[j]);
-							}
-							printf("\n");
-							json_parser_pop_depth(parser, &index);
-							if (index >= 0) {
-								printf("index: %lld, type: %d\n", index, parser->temporaries.objects[index].value_type);
-								if (parser->temporaries.objects[index].value_type != JSON_OBJECT_TYPE_ARRAY) {
-									fprintf(stderr, LOG_STRING"Found illegal \']\' on index %lld\n", __FILE__, __LINE__, index);
-									return CSON_PARSER_STATE_INVALID_CHARACTER;
-								}
-								if (parser->temporaries.length > 0 
-									&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
-								) {
-									res = validate_number(parser);
-									if (res) {
-										printf(LOG_STRING"number invalidated\n", __FILE__, __LINE__);
-										return res;
-									}
-								} 
-								json_array_t *arr = parser->temporaries.objects[index].array;
-								for (ssize_t j = index + 1; j < parser->temporaries.length; ++j) {
-									printf("moving value to array\n");
-									json_value_printf(&parser->temporaries.objects[j], 0, true);
-									json_array_move_value(arr, &parser->temporaries.objects[j]);
-									parser->temporaries.objects[j] = (json_value_t){};
-								}
-								printf("new length: %lld\n", index);
-								parser->temporaries.length = index + 1;
-								printf("array:\n");
-								json_array_printf(arr, 0);
-								printf("\n");
-								break;
-							} else {
-								if (parser->value.value_type != JSON_OBJECT_TYPE_ARRAY) {
-									fprintf(stderr, LOG_STRING"Failed to find array\n", __FILE__, __LINE__);
-									exit(-1);
-								} else {
-									if (parser->temporaries.length > 0 
-										&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
-									) {
-										res = validate_number(parser);
-										if (res) {
-											printf(LOG_STRING"number invalidated\n", __FILE__, __LINE__);
-											return res;
-										}
-									} 
-									index++;
-									for (ssize_t j = index; j < parser->temporaries.length; ++j) {
-										printf("moving value to array\n");
-										json_value_printf(&parser->temporaries.objects[j], 0, true);
-										printf("\n");
-										json_array_move_value(parser->value.array, &parser->temporaries.objects[j]);
-										parser->temporaries.objects[j] = (json_value_t){};
-									}
-									printf("new length: %lld\n", index);
-									parser->temporaries.length = index;
-									printf("array:\n");
-									json_array_printf(parser->value.array, 0);
-									printf("\n");
-								}
-							}
-							current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-							parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
+					if (parser->temporaries.length > 0
+						&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
+					) {
+						res = validate_number(parser);
+						if (res) {
+							json_trace("number invalidated");
+							return res;
 						}
 					}
-				} break;
-				case ',': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {
-							printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-							res = json_parser_pop_state(parser, &current_state);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_F64: {
-						}
-						case CSON_PARSER_STATE_I64:
-						case CSON_PARSER_STATE_U64: {
-							res = validate_number(parser);
-							if (res) {
-								return res;
-							}
-							printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-							res = json_parser_pop_state(parser, &current_state);
-							if (res) return res;
-							parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
-							parser->exponent = 0;
-						} __attribute__((fallthrough));
-						case CSON_PARSER_STATE_NULL: {
-							json_parser_flags_printf(parser->parser_flag);
-							if (parser->parser_flag & (CSON_PARSER_FLAG_FOUND_TRAILING_COMMA | CSON_PARSER_FLAG_FOUND_KEY_START | CSON_PARSER_FLAG_FOUND_KEY_END | CSON_PARSER_FLAG_FOUND_VALUE_START)) {
-								fprintf(stderr, LOG_STRING"INVALID STATE\n", __FILE__, __LINE__);
-								exit(-1);
-							}
-							parser->parser_flag |= CSON_PARSER_FLAG_FOUND_TRAILING_COMMA;
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid character %c at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						}
+					index++;
+					res = json_parser_size_object(parser, parser->value.object, parser->key_count);
+					if (res) return res;
+					for (ssize_t j = 0, k = 0; j < parser->temporaries.length && k < parser->key_count; ++j, ++k) {
+						json_trace("moving value with key \"%.*s\" to object", (int)parser->temporary_keys[k].length, json_string_data(&parser->temporary_keys[k]));
+						json_trace_dump(json_value_printf(&parser->temporaries.objects[j], 0, true), printf("\n"));
+						res = json_parser_move_member(parser, parser->value.object, &parser->temporary_keys[k], &parser->temporaries.objects[j]);
+						if (res) return res;
 					}
-				} break;
-				case '\\': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_ESCAPE: {
-							printf(LOG_STRING"Popping state\n", __FILE__, __LINE__);
-							json_parser_pop_state(parser, &current_state);
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to pop state due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-							switch (current_state) {
-								case CSON_PARSER_STATE_STRING: {
-									json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-									res = json_string_append_char(str, ch);
-									if (res) return res;
-								} break;
-								case CSON_PARSER_STATE_KEY: {
-									json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-									res = json_string_append_char(str, ch);
-									if (res) return res;
-								} break;
-								default: {
-									fprintf(stderr, LOG_STRING"Unreachable state reached.\n", __FILE__, __LINE__);
-									exit(-1);
-								} break;
-							}
-						} break;
-						case CSON_PARSER_STATE_STRING:  
-						case CSON_PARSER_STATE_KEY: {
-							printf("Entering escape mode\n");
-							printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
-							res = json_parser_push_state(parser, current_state);
-							if (res) {
-								fprintf(stderr, LOG_STRING"Failed to push state into parser due to error %d\n", __FILE__, __LINE__, res);
-								return res;
-							}
-							current_state = CSON_PARSER_STATE_ESCAPE;
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found invalid escape character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+					json_trace("new length: %lld", index);
+					parser->temporaries.length = 0;
+					parser->key_count = 0;
+					json_trace("object:");
+					json_trace_dump(json_object_printf(parser->value.object, 0, true), printf("\n"));
+				}
+				current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
+				parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
+				continue;
+			}
+			JSON_PARSER_ACTION(ROOT_ARRAY) {
+				json_array_t *array = json_allocator_malloc(parser->allocator, sizeof(json_array_t));
+				if (!array) {
+					json_error("Failed to initialize first array");
+					return CSON_ERR_ALLOC;
+				}
+				*array = (json_array_t){
+					.allocator = json_allocator_resolve(parser->allocator)
+				};
+				json_value_t val = {
+					.value_type = JSON_OBJECT_TYPE_ARRAY,
+					.array = array
+				};
+				parser->value = val;
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) {
+					return res;
+				}
+				current_state = CSON_PARSER_STATE_ARRAY;
+				continue;
+			}
+			JSON_PARSER_ACTION(NESTED_ARRAY) {
+				if (current_state == CSON_PARSER_STATE_OBJECT && !(parser->parser_flag & CSON_PARSER_FLAG_FOUND_VALUE_START)) {
+					json_error("Found \'[\' at index %lld without key", parser->pointer);
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				res = json_parser_push_depth(parser);
+				if (res) {
+					return res;
+				}
+				json_array_t *array = json_allocator_malloc(parser->allocator, sizeof(json_array_t));
+				if (!array) {
+					json_error("Failed to initialize array");
+					return CSON_ERR_ALLOC;
+				}
+				*array = (json_array_t){
+					.allocator = json_allocator_resolve(parser->allocator)
+				};
+				json_value_t val = {
+					.value_type = JSON_OBJECT_TYPE_ARRAY,
+					.array = array
+				};
+				res = json_parser_push_temporary(parser, &val, false);
+				if (res) {
+					json_error("Failed to push temporary into parser due to error %d", res);
+					return res;
+				}
+				json_trace("Pushing state");
+				res = json_parser_push_state(parser, current_state);
+				if (res) {
+					return res;
+				}
+				current_state = CSON_PARSER_STATE_ARRAY;
+				continue;
+			}
+			JSON_PARSER_ACTION(ARRAY_END) {
+				if (parser->parser_flag & CSON_PARSER_FLAG_FOUND_TRAILING_COMMA) {
+					json_error("Found trailing comma");
+					return CSON_PARSER_STATE_INVALID_CHARACTER;
+				}
+				if (current_state == CSON_PARSER_STATE_EXPECT_END_OR_COMMA) {
+					json_trace("Popping state");
+					json_parser_pop_state(parser, NULL);
+				}
+				ssize_t index = -1;
+#if CSON_TRACE_LEVEL >= CSON_TRACE_LEVEL_TRACE
+				json_trace("temporaries:");
+				for (ssize_t i = 0; i < parser->temporaries.length; ++i) {
+					printf("i: %lld, ", i);
+					json_value_printf(&parser->temporaries.objects[i], 0, true);
+					printf("\n");
+				}
+				for (ssize_t j = 0; j < parser->depth_count; ++j) {
+					json_trace("depth %lld: %lld", j, parser->depth[j]);
+				}
+#endif // CSON_TRACE_LEVEL
+				json_parser_pop_depth(parser, &index);
+				if (index >= 0) {
+					json_trace("index: %lld, type: %d", index, parser->temporaries.objects[index].value_type);
+					if (parser->temporaries.objects[index].value_type != JSON_OBJECT_TYPE_ARRAY) {
+						json_error("Found illegal \']\' on index %lld", index);
+						return CSON_PARSER_STATE_INVALID_CHARACTER;
 					}
-				} break;
-				case ' ': {
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_I64: 
-						case CSON_PARSER_STATE_F64: 
-						case CSON_PARSER_STATE_U64: {
-							current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-							printf("Expecting comma or end\n");
+					if (parser->temporaries.length > 0
+						&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
+					) {
+						res = validate_number(parser);
+						if (res) {
+							json_trace("number invalidated");
+							return res;
 						}
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {}
-						case CSON_PARSER_STATE_IDLE: {
-							
-						
-						} break;
-						case CSON_PARSER_STATE_OBJECT: {} break;
-						case CSON_PARSER_STATE_ARRAY: {} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found illegal \' \' character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
 					}
-				} break;
-				case '\r': {
-					printf("Found \"\\r\" at index %lld\n", parser->pointer);
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_I64: 
-						case CSON_PARSER_STATE_F64: 
-						case CSON_PARSER_STATE_U64: {
-							current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-							printf("Expecting comma or end\n");
-						} break;
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {} break;
-						case CSON_PARSER_STATE_IDLE: {} break;
-						case CSON_PARSER_STATE_ESCAPE: {} break;
-						case CSON_PARSER_STATE_OBJECT: {} break;
-						case CSON_PARSER_STATE_ARRAY: {} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found illegal \' \' character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+					json_array_t *arr = parser->temporaries.objects[index].array;
+					res = json_parser_size_array(parser, arr, parser->temporaries.length - index - 1);
+					if (res) return res;
+					for (ssize_t j = index + 1; j < parser->temporaries.length; ++j) {
+						json_trace("moving value to array");
+						json_trace_dump(json_value_printf(&parser->temporaries.objects[j], 0, true), printf("\n"));
+						json_array_move_value(arr, &parser->temporaries.objects[j]);
+						parser->temporaries.objects[j] = (json_value_t){};
 					}
-				} break;
-				case '\t': {
-					printf("Found \"\\t\" at index %lld\n", parser->pointer);
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_I64: 
-						case CSON_PARSER_STATE_F64: 
-						case CSON_PARSER_STATE_U64: {
-							current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-							printf("Expecting comma or end\n");
-						} break;
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {} break;
-						case CSON_PARSER_STATE_IDLE: {} break;
-						case CSON_PARSER_STATE_OBJECT: {} break;
-						case CSON_PARSER_STATE_ARRAY: {} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found illegal \' \' character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+					json_trace("new length: %lld", index);
+					parser->temporaries.length = index + 1;
+					json_trace("array:");
+					json_trace_dump(json_array_printf(arr, 0), printf("\n"));
+				} else {
+					if (parser->value.value_type != JSON_OBJECT_TYPE_ARRAY) {
+						json_error("Failed to find array");
+						return CSON_PARSER_STATE_INVALID_CHARACTER;
 					}
-				} break;
-				case '\0': {
-					
-				} break;
-				case '\n': {
-					printf("Found \"\\n\" at index %lld\n", parser->pointer);
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_I64: 
-						case CSON_PARSER_STATE_F64: 
-						case CSON_PARSER_STATE_U64: {
-							current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
-							printf("Expecting comma or end\n");
-						} break;
-						case CSON_PARSER_STATE_EXPECT_END_OR_COMMA: {} break;
-						case CSON_PARSER_STATE_IDLE: {} break;
-						case CSON_PARSER_STATE_OBJECT: {} break;
-						case CSON_PARSER_STATE_ARRAY: {} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found illegal \' \' character at index %lld\n", __FILE__, __LINE__, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+					if (parser->temporaries.length > 0
+						&& parser->temporaries.objects[parser->temporaries.length - 1].value_type == JSON_OBJECT_TYPE_NUMBER
+					) {
+						res = validate_number(parser);
+						if (res) {
+							json_trace("number invalidated");
+							return res;
+						}
 					}
-				} break;
-				default: {
-					switch (current_state) {
-						case CSON_PARSER_STATE_KEY: {
-							json_string_t *str = &parser->temporary_keys[parser->key_count - 1];
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						case CSON_PARSER_STATE_STRING: {
-							json_string_t *str = &parser->temporaries.objects[parser->temporaries.length - 1].string;
-							res = json_string_append_char(str, ch);
-							if (res) return res;
-						} break;
-						default: {
-							fprintf(stderr, LOG_STRING"Found illegal \'%c\' character at index %lld\n", __FILE__, __LINE__, ch, parser->pointer);
-							return CSON_PARSER_STATE_INVALID_CHARACTER;
-						} break;
+					index++;
+					res = json_parser_size_array(parser, parser->value.array, parser->temporaries.length - index);
+					if (res) return res;
+					for (ssize_t j = index; j < parser->temporaries.length; ++j) {
+						json_trace("moving value to array");
+						json_trace_dump(json_value_printf(&parser->temporaries.objects[j], 0, true), printf("\n"));
+						json_array_move_value(parser->value.array, &parser->temporaries.objects[j]);
+						parser->temporaries.objects[j] = (json_value_t){};
 					}
-				} break;
+					json_trace("new length: %lld", index);
+					parser->temporaries.length = index;
+					json_trace("array:");
+					json_trace_dump(json_array_printf(parser->value.array, 0), printf("\n"));
+				}
+				current_state = CSON_PARSER_STATE_EXPECT_END_OR_COMMA;
+				parser->parser_flag &= ~(CSON_PARSER_FLAG_FOUND_SIGN | CSON_PARSER_FLAG_FOUND_PERIOD | CSON_PARSER_FLAG_FOUND_VALUE_START | CSON_PARSER_FLAG_FOUND_EXPONENT | CSON_PARSER_FLAG_FOUND_NEGATIVE_EXPONENT);
+				continue;
 			}
-		} 
+		}
 	}
-	printf(LOG_STRING"Pushing state\n", __FILE__, __LINE__);
+	json_trace("Pushing state");
 	json_parser_push_state(parser, current_state);
 
 	return 0;
 }
 
 int32_t json_parser_finalize(json_parser_t *const parser, json_value_t *val) {
-	printf("Finalizing\n");
+	json_trace("Finalizing");
 	if (parser->parser_flag || 
 		parser->temporaries.length 
 		|| parser->key_count 
-		|| parser->state_count > 2
+		|| parser->state_count != 2
 		|| parser->states[0] != CSON_PARSER_STATE_IDLE
 		|| parser->states[1] != CSON_PARSER_STATE_EXPECT_END_OR_COMMA
 	) {
-		fprintf(stderr, LOG_STRING"Failed to properly parse file.\n", __FILE__, __LINE__);
-		json_parser_flags_printf(parser->parser_flag);
-		json_parser_print_state(parser);
+		json_error("Failed to properly parse file.");
+		json_trace_dump(json_parser_flags_printf(parser->parser_flag), json_parser_print_state(parser));
 		return CSON_PARSER_STATE_INVALID_CHARACTER;
 	}
-	printf("-----------------------------------------FINAL-----------------------------------------\n");
-	json_value_printf(&parser->value, 0, true);
-	printf("\n");
-	printf("-----------------------------------------FINAL-----------------------------------------\n");
+	json_trace("final value:");
+	json_trace_dump(json_value_printf(&parser->value, 0, true), printf("\n"));
 	if (val) *val = parser->value;
-	else json_value_free(&parser->value);
-	printf("\n");
+	else json_value_free(&parser->value, parser->allocator);
 	return 0;
 }
 
@@ -1623,44 +1679,245 @@ int32_t json_parse(json_parser_t *const parser, json_value_t *value, const char
 	if (!filename || !parser) return CSON_ERR_NULL_PTR;
 	FILE *file = fopen64(filename, "r");
 	if (!file) {
-		printf("Failed to open file %s\n", filename);
+		json_error("Failed to open file %s", filename);
 		return errno;
 	}
 	int res = 0;
 	ssize_t n = fread(parser->buf, sizeof(char), BUFFER_SIZE, file); 
 	while (n) {
-		printf("read %lld bytes\n", n);
-		res = json_parser_digest(parser, n);
+		json_trace("read %lld bytes", n);
+		res = json_parser_digest(parser, parser->buf, n, BUFFER_SIZE - n);
 		if (res) goto cleanup;
 		n = fread(parser->buf, sizeof(char), BUFFER_SIZE, file); 
 	}
 	res = json_parser_finalize(parser, value);
 	cleanup:
-	if (res) json_value_free(&parser->value);
+	if (res) json_value_free(&parser->value, parser->allocator);
 		json_parser_free(parser);
 		fclose(file);
 	return res;
 }
 
+int32_t json_document_unmap(json_document_t *document) {
+	if (!document) return CSON_ERR_NULL_PTR;
+	if (document->mapping) {
+		json_trace("Unmapping %lld byte(s)", document->mapping_length);
+#ifdef _WIN32
+		UnmapViewOfFile(document->mapping);
+#else
+		munmap(document->mapping, document->mapping_length);
+#endif // _WIN32
+	}
+	document->mapping = NULL;
+	document->mapping_length = 0;
+	document->input = NULL;
+	document->input_length = 0;
+	return 0;
+}
+
+int32_t json_document_map(json_document_t *document, const char *const filename) {
+	if (!document || !filename) return CSON_ERR_NULL_PTR;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		json_error("Failed to open file %s", filename);
+		return CSON_ERR_NOT_FOUND;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+		CloseHandle(file);
+		return CSON_ERR_INVALID_ARGUMENT;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping) {
+		json_error("Failed to map file %s", filename);
+		return CSON_ERR_ALLOC;
+	}
+	// The view keeps the mapping object alive, so its handle can go right away.
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) {
+		json_error("Failed to map file %s", filename);
+		return CSON_ERR_ALLOC;
+	}
+	size_t length = (size_t)size.QuadPart;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		json_error("Failed to open file %s", filename);
+		return errno;
+	}
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return CSON_ERR_INVALID_ARGUMENT;
+	}
+	if ((uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		return CSON_ERR_MAX_SIZE_REACHED;
+	}
+	size_t length = (size_t)st.st_size;
+	void *view = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		json_error("Failed to map file %s", filename);
+		return CSON_ERR_ALLOC;
+	}
+	// The file is read front to back exactly once, let the kernel read ahead
+	// aggressively and drop pages behind us.
+	madvise(view, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	madvise(view, length, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+#endif // _WIN32
+	document->mapping = view;
+	document->mapping_length = length;
+	document->input = view;
+	document->input_length = length;
+	return 0;
+}
+
+int32_t json_parse_mmap(json_parser_t *const parser, json_document_t *document, const char *const filename) {
+	if (!filename || !parser || !document) return CSON_ERR_NULL_PTR;
+	*document = (json_document_t){};
+	int res = json_document_map(document, filename);
+	if (res) {
+		json_parser_free(parser);
+		return res;
+	}
+	// The document's own structures, and the arena's blocks, come from the parser's
+	// allocator. With an arena the tree itself comes from the arena instead.
+	document->allocator = parser->allocator;
+	if (parser->options & CSON_PARSER_OPTION_ARENA) {
+		document->arena = json_allocator_malloc(document->allocator, sizeof(json_arena_t));
+		if (!document->arena) {
+			res = CSON_ERR_ALLOC;
+			goto cleanup;
+		}
+		json_arena_init(document->arena, 0, document->allocator);
+		parser->allocator = &document->arena->allocator;
+	}
+	if ((parser->options & CSON_PARSER_OPTION_INTERN_KEYS) && !parser->intern) {
+		document->intern = json_allocator_malloc(document->allocator, sizeof(json_intern_table_t));
+		if (!document->intern) {
+			res = CSON_ERR_ALLOC;
+			goto cleanup;
+		}
+		json_intern_init(document->intern, document->allocator);
+		parser->intern = document->intern;
+	}
+	parser->input = document->input;
+	// Digest the mapping in windows so the structural index stays bounded no matter
+	// how large the file is.
+	for (size_t offset = 0; offset < document->input_length; offset += CSON_MMAP_WINDOW_SIZE) {
+		size_t n = document->input_length - offset;
+		if (n > CSON_MMAP_WINDOW_SIZE) n = CSON_MMAP_WINDOW_SIZE;
+		res = json_parser_digest(parser, document->input + offset, n, document->input_length - offset - n);
+		if (res) goto cleanup;
+#ifndef _WIN32
+		// Unless strings borrow from it nothing points into a finished window, release
+		// its pages so files larger than RAM do not push the rest of the system out of memory.
+		if (!json_parser_borrows(parser)) madvise((char *)document->mapping + offset, n, MADV_DONTNEED);
+#endif // _WIN32
+	}
+	res = json_parser_finalize(parser, &document->root);
+	cleanup:
+	// An arena takes the partial tree with it, nothing to walk.
+	if (res && !document->arena) json_value_free(&parser->value, parser->allocator);
+	json_parser_free(parser);
+	if (res) json_document_free(document);
+	return res;
+}
+
+int32_t json_parser_digest_input(json_parser_t *const parser, const char *const data, size_t len, size_t padding) {
+	for (size_t offset = 0; offset < len; offset += CSON_MMAP_WINDOW_SIZE) {
+		size_t n = len - offset;
+		if (n > CSON_MMAP_WINDOW_SIZE) n = CSON_MMAP_WINDOW_SIZE;
+		int res = json_parser_digest(parser, data + offset, n, len - offset - n + padding);
+		if (res) return res;
+	}
+	return 0;
+}
+
+int32_t json_parse_buffer_padded(json_parser_t *const parser, json_value_t *value, const char *const data, size_t len) {
+	if (!parser || !data) return CSON_ERR_NULL_PTR;
+	parser->input = data;
+	int res = json_parser_digest_input(parser, data, len, CSON_PADDING);
+	if (!res) res = json_parser_finalize(parser, value);
+	if (res) json_value_free(&parser->value, parser->allocator);
+	json_parser_free(parser);
+	return res;
+}
+
+int32_t json_parse_buffer(json_parser_t *const parser, json_value_t *value, const char *const data, size_t len) {
+	if (!parser || !data) return CSON_ERR_NULL_PTR;
+	parser->input = data;
+	int res = json_parser_digest_input(parser, data, len, 0);
+	if (!res) res = json_parser_finalize(parser, value);
+	if (res) json_value_free(&parser->value, parser->allocator);
+	json_parser_free(parser);
+	return res;
+}
+
+int32_t json_parse_insitu(json_parser_t *const parser, json_value_t *value, char *const data, size_t len) {
+	if (!parser || !data) return CSON_ERR_NULL_PTR;
+	parser->input = data;
+	parser->options |= CSON_PARSER_OPTION_INSITU;
+	int res = json_parser_digest_input(parser, data, len, 0);
+	if (!res) res = json_parser_finalize(parser, value);
+	if (res) json_value_free(&parser->value, parser->allocator);
+	json_parser_free(parser);
+	return res;
+}
+
+int32_t json_document_free(json_document_t *document) {
+	if (!document) return CSON_ERR_NULL_PTR;
+	if (document->arena) {
+		json_trace("Freeing document arena");
+		json_arena_free(document->arena);
+		json_allocator_free(document->allocator, document->arena, sizeof(json_arena_t));
+	}
+	else json_value_free(&document->root, document->allocator);
+	if (document->intern) {
+		json_intern_free(document->intern);
+		json_allocator_free(document->allocator, document->intern, sizeof(json_intern_table_t));
+	}
+	json_document_unmap(document);
+	*document = (json_document_t){};
+	return 0;
+}
+
 int32_t json_parser_free(json_parser_t *parser) {
 	if (!parser) return CSON_ERR_NULL_PTR;
 	if (parser->depth) {
-		printf("Freeing depth stack\n");
-		debug_free(parser->depth);
+		json_trace("Freeing depth stack");
+		json_allocator_free(parser->scratch_allocator, parser->depth, parser->depth_size * sizeof(ssize_t));
 	}
+	if (parser->index.positions) {
+		json_trace("Freeing structural index");
+		json_structural_index_free(&parser->index);
+	}
+	json_string_free(&parser->number_digits, parser->scratch_allocator);
+	json_string_free(&parser->string, parser->allocator);
 	if (parser->temporary_keys) {
-		printf("Freeing temporary keys\n");
+		json_trace("Freeing temporary keys");
 		for (ssize_t i = 0; i < parser->key_count; ++i) {
-			json_string_free(&parser->temporary_keys[i]);
+			json_string_free(&parser->temporary_keys[i], parser->allocator);
 		}
-		debug_free(parser->temporary_keys);
+		json_allocator_free(parser->scratch_allocator, parser->temporary_keys, parser->key_size * sizeof(json_string_t));
 	}
 	if (parser->states) {
-		printf("Freeing states\n");
-		debug_free(parser->states);
+		json_trace("Freeing states");
+		json_allocator_free(parser->scratch_allocator, parser->states, parser->state_size * sizeof(json_parser_state_t));
 	}
 	if (parser->temporaries.objects) {
-		printf("Freeing temporaries\n");
+		json_trace("Freeing temporaries");
+		// The array is scratch, whatever is still in it came from the tree allocator.
+		for (ssize_t i = 0; i < parser->temporaries.length; ++i) {
+			json_value_free(&parser->temporaries.objects[i], parser->allocator);
+		}
+		parser->temporaries.length = 0;
 		json_array_free(&parser->temporaries);
 	}
 	*parser = (json_parser_t){};
@@ -0,0 +1,271 @@
+#include "../include/cson_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSON_SIMD_X86
+#endif
+
+static void json_simd_classify_block_scalar(const char *const block, json_simd_block_t *masks) {
+	*masks = (json_simd_block_t){};
+	for (int32_t i = 0; i < CSON_SIMD_BLOCK_SIZE; ++i) {
+		switch (block[i]) {
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',': {
+				masks->structural |= 1ULL << i;
+			} break;
+			case '\"': {
+				masks->quote |= 1ULL << i;
+			} break;
+			case '\\': {
+				masks->backslash |= 1ULL << i;
+			} break;
+			default: break;
+		}
+	}
+}
+
+static inline bool json_simd_is_string_special(const char ch) {
+	return ch == '\"' || ch == '\\' || (unsigned char)ch < 0x20;
+}
+
+static ssize_t json_simd_find_string_special_scalar(const char *const buf, ssize_t n) {
+	ssize_t i = 0;
+	while (i < n && !json_simd_is_string_special(buf[i])) i++;
+	return i;
+}
+
+static ssize_t json_simd_skip_whitespace_scalar(const char *const buf, ssize_t n) {
+	ssize_t i = 0;
+	while (i < n && (buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\n' || buf[i] == '\r')) i++;
+	return i;
+}
+
+#ifdef CSON_SIMD_X86
+__attribute__((target("sse2")))
+static void json_simd_classify_block_sse2(const char *const block, json_simd_block_t *masks) {
+	// '[' and ']' only differ from '{' and '}' by bit 0x20, so one OR folds them together.
+	const __m128i fold = _mm_set1_epi8(0x20);
+	const __m128i open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+	const __m128i colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+	const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\');
+	*masks = (json_simd_block_t){};
+	for (int32_t i = 0; i < CSON_SIMD_BLOCK_SIZE; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(block + i));
+		__m128i folded = _mm_or_si128(chunk, fold);
+		__m128i structural = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma))
+		);
+		masks->structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural) << i;
+		masks->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) << i;
+		masks->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)) << i;
+	}
+}
+
+__attribute__((target("avx2")))
+static void json_simd_classify_block_avx2(const char *const block, json_simd_block_t *masks) {
+	const __m256i fold = _mm256_set1_epi8(0x20);
+	const __m256i open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}');
+	const __m256i colon = _mm256_set1_epi8(':'), comma = _mm256_set1_epi8(',');
+	const __m256i quote = _mm256_set1_epi8('\"'), backslash = _mm256_set1_epi8('\\');
+	*masks = (json_simd_block_t){};
+	for (int32_t i = 0; i < CSON_SIMD_BLOCK_SIZE; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(block + i));
+		__m256i folded = _mm256_or_si256(chunk, fold);
+		__m256i structural = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma))
+		);
+		masks->structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << i;
+		masks->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)) << i;
+		masks->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)) << i;
+	}
+}
+
+__attribute__((target("sse2")))
+static ssize_t json_simd_find_string_special_sse2(const char *const buf, ssize_t n) {
+	const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\');
+	// max(x, 0x1F) == 0x1F exactly when x <= 0x1F as an unsigned byte.
+	const __m128i control = _mm_set1_epi8(0x1F);
+	ssize_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(buf + i));
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control)
+		);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+		if (mask) return i + __builtin_ctz(mask);
+	}
+	return i + json_simd_find_string_special_scalar(buf + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static ssize_t json_simd_find_string_special_avx2(const char *const buf, ssize_t n) {
+	const __m256i quote = _mm256_set1_epi8('\"'), backslash = _mm256_set1_epi8('\\');
+	const __m256i control = _mm256_set1_epi8(0x1F);
+	ssize_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(buf + i));
+		__m256i special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+			_mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control)
+		);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+		if (mask) return i + __builtin_ctz(mask);
+	}
+	return i + json_simd_find_string_special_scalar(buf + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static ssize_t json_simd_skip_whitespace_sse2(const char *const buf, ssize_t n) {
+	const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+	const __m128i newline = _mm_set1_epi8('\n'), carriage = _mm_set1_epi8('\r');
+	ssize_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(buf + i));
+		__m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage))
+		);
+		uint32_t mask = ~(uint32_t)_mm_movemask_epi8(whitespace) & 0xFFFF;
+		if (mask) return i + __builtin_ctz(mask);
+	}
+	return i + json_simd_skip_whitespace_scalar(buf + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static ssize_t json_simd_skip_whitespace_avx2(const char *const buf, ssize_t n) {
+	const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+	const __m256i newline = _mm256_set1_epi8('\n'), carriage = _mm256_set1_epi8('\r');
+	ssize_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(buf + i));
+		__m256i whitespace = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, carriage))
+		);
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(whitespace);
+		if (mask) return i + __builtin_ctz(mask);
+	}
+	return i + json_simd_skip_whitespace_scalar(buf + i, n - i);
+}
+#endif // CSON_SIMD_X86
+
+static void json_simd_classify_block_select(const char *const block, json_simd_block_t *masks);
+static ssize_t json_simd_find_string_special_select(const char *const buf, ssize_t n);
+static ssize_t json_simd_skip_whitespace_select(const char *const buf, ssize_t n);
+
+static void (*json_simd_classify_block_impl)(const char *const, json_simd_block_t *) = json_simd_classify_block_select;
+static ssize_t (*json_simd_find_string_special_impl)(const char *const, ssize_t) = json_simd_find_string_special_select;
+static ssize_t (*json_simd_skip_whitespace_impl)(const char *const, ssize_t) = json_simd_skip_whitespace_select;
+
+// Resolves the best kernels for the running CPU on first use.
+static void json_simd_select(void) {
+	json_simd_classify_block_impl = json_simd_classify_block_scalar;
+	json_simd_find_string_special_impl = json_simd_find_string_special_scalar;
+	json_simd_skip_whitespace_impl = json_simd_skip_whitespace_scalar;
+#ifdef CSON_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		json_simd_classify_block_impl = json_simd_classify_block_avx2;
+		json_simd_find_string_special_impl = json_simd_find_string_special_avx2;
+		json_simd_skip_whitespace_impl = json_simd_skip_whitespace_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		json_simd_classify_block_impl = json_simd_classify_block_sse2;
+		json_simd_find_string_special_impl = json_simd_find_string_special_sse2;
+		json_simd_skip_whitespace_impl = json_simd_skip_whitespace_sse2;
+	}
+#endif // CSON_SIMD_X86
+}
+
+static void json_simd_classify_block_select(const char *const block, json_simd_block_t *masks) {
+	json_simd_select();
+	json_simd_classify_block_impl(block, masks);
+}
+
+static ssize_t json_simd_find_string_special_select(const char *const buf, ssize_t n) {
+	json_simd_select();
+	return json_simd_find_string_special_impl(buf, n);
+}
+
+static ssize_t json_simd_skip_whitespace_select(const char *const buf, ssize_t n) {
+	json_simd_select();
+	return json_simd_skip_whitespace_impl(buf, n);
+}
+
+void json_simd_classify_block(const char *const block, json_simd_block_t *masks) {
+	json_simd_classify_block_impl(block, masks);
+}
+
+ssize_t json_simd_find_string_special(const char *const buf, ssize_t n) {
+	return json_simd_find_string_special_impl(buf, n);
+}
+
+ssize_t json_simd_skip_whitespace(const char *const buf, ssize_t n) {
+	return json_simd_skip_whitespace_impl(buf, n);
+}
+
+int32_t json_structural_index_init(json_structural_index_t *index, ssize_t size, const json_allocator_t *allocator) {
+	if (!index) return CSON_ERR_NULL_PTR;
+	if (size <= 0) return CSON_ERR_INVALID_ARGUMENT;
+	index->allocator = json_allocator_resolve(allocator);
+	index->positions = json_allocator_malloc(index->allocator, size * sizeof(uint32_t));
+	if (!index->positions) {
+		json_error("Failed to allocate memory for structural index");
+		return CSON_ERR_ALLOC;
+	}
+	index->count = 0;
+	index->cursor = 0;
+	index->size = size;
+	return 0;
+}
+
+int32_t json_structural_index_build(json_structural_index_t *index, const char *const buf, ssize_t n, ssize_t padding) {
+	if (!index || !buf) return CSON_ERR_NULL_PTR;
+	if (n < 0 || padding < 0) return CSON_ERR_INVALID_ARGUMENT;
+	if ((uint64_t)n > UINT32_MAX) return CSON_ERR_MAX_SIZE_REACHED;
+	// A buffer can never hold more interesting characters than bytes, so sizing the
+	// index to the buffer up front keeps the flattening loop free of bounds checks.
+	if (n > index->size) {
+		uint32_t *tmp = json_allocator_realloc(index->allocator, index->positions, index->size * sizeof(uint32_t), n * sizeof(uint32_t));
+		if (!tmp) {
+			json_error("Failed to grow structural index to %lld positions", n);
+			return CSON_ERR_ALLOC;
+		}
+		index->positions = tmp;
+		index->size = n;
+	}
+	index->count = 0;
+	index->cursor = 0;
+	json_simd_block_t masks;
+	for (ssize_t offset = 0; offset < n; offset += CSON_SIMD_BLOCK_SIZE) {
+		if (n + padding - offset >= CSON_SIMD_BLOCK_SIZE) {
+			json_simd_classify_block(buf + offset, &masks);
+		} else {
+			char tail[CSON_SIMD_BLOCK_SIZE];
+			memset(tail, ' ', CSON_SIMD_BLOCK_SIZE);
+			memcpy(tail, buf + offset, n - offset);
+			json_simd_classify_block(tail, &masks);
+		}
+		uint64_t bits = masks.structural | masks.quote | masks.backslash;
+		// Whatever sits in the padding is not part of the input.
+		if (n - offset < CSON_SIMD_BLOCK_SIZE) bits &= (1ULL << (n - offset)) - 1;
+		while (bits) {
+			index->positions[index->count++] = (uint32_t)(offset + __builtin_ctzll(bits));
+			bits &= bits - 1;
+		}
+	}
+	return 0;
+}
+
+int32_t json_structural_index_free(json_structural_index_t *index) {
+	if (!index) return CSON_ERR_NULL_PTR;
+	if (index->positions) json_allocator_free(index->allocator, index->positions, index->size * sizeof(uint32_t));
+	*index = (json_structural_index_t){};
+	return 0;
+}
@@ -0,0 +1,237 @@
+#include "../include/cson_tape.h"
+#include "../include/cson_parser.h"
+
+// Marks the outermost container, whose START word has no parent to point to.
+#define JSON_TAPE_NO_PARENT JSON_TAPE_PAYLOAD_MASK
+
+typedef struct {
+	json_tape_t *tape;
+	const char *buf;
+	size_t len, pointer;
+	size_t word_capacity;
+	// START word of the innermost open container. Until it is closed its payload
+	// links to the enclosing one, so nesting needs no stack of its own.
+	size_t open;
+} json_tape_builder_t;
+
+static inline int32_t json_tape_push(json_tape_builder_t *builder, json_tape_type_t type, uint64_t payload) {
+	json_tape_t *tape = builder->tape;
+	if (tape->count >= builder->word_capacity) return CSON_ERR_MAX_SIZE_REACHED;
+	tape->words[tape->count++] = ((uint64_t)type << 56) | (payload & JSON_TAPE_PAYLOAD_MASK);
+	return 0;
+}
+
+// Numbers take two words, the tag and the untagged value.
+static inline int32_t json_tape_push_raw(json_tape_builder_t *builder, json_tape_type_t type, uint64_t raw) {
+	json_tape_t *tape = builder->tape;
+	if (tape->count + 2 > builder->word_capacity) return CSON_ERR_MAX_SIZE_REACHED;
+	tape->words[tape->count++] = (uint64_t)type << 56;
+	tape->words[tape->count++] = raw;
+	return 0;
+}
+
+static inline void json_tape_skip_whitespace(json_tape_builder_t *builder) {
+	builder->pointer += json_simd_skip_whitespace(builder->buf + builder->pointer, builder->len - builder->pointer);
+}
+
+static inline int32_t json_tape_open(json_tape_builder_t *builder, json_tape_type_t type) {
+	size_t index = builder->tape->count;
+	int res = json_tape_push(builder, type, builder->open);
+	if (res) return res;
+	builder->open = index;
+	builder->pointer++;
+	return 0;
+}
+
+static inline int32_t json_tape_close(json_tape_builder_t *builder, json_tape_type_t type) {
+	json_tape_t *tape = builder->tape;
+	size_t start = builder->open;
+	size_t end = tape->count;
+	int res = json_tape_push(builder, type, start);
+	if (res) return res;
+	builder->open = json_tape_payload(tape, start);
+	tape->words[start] = (tape->words[start] & ~JSON_TAPE_PAYLOAD_MASK) | end;
+	builder->pointer++;
+	return 0;
+}
+
+// Decodes the string opening at buf[pointer] straight into the string buffer.
+static int32_t json_tape_parse_string(json_tape_builder_t *builder) {
+	json_tape_t *tape = builder->tape;
+	size_t offset = tape->strings_length;
+	char *out = tape->strings + offset + sizeof(uint32_t);
+	size_t length, consumed;
+	int res = json_string_unescape(builder->buf + builder->pointer + 1, builder->len - builder->pointer - 1, out, &length, &consumed);
+	if (res) return res == CSON_ERR_INVALID_ARGUMENT ? CSON_PARSER_STATE_INVALID_CHARACTER : res;
+	if (length > UINT32_MAX) return CSON_ERR_MAX_SIZE_REACHED;
+	uint32_t n = (uint32_t)length;
+	memcpy(tape->strings + offset, &n, sizeof(n));
+	out[length] = '\0';
+	tape->strings_length = offset + sizeof(n) + length + 1;
+	builder->pointer += consumed + 1;
+	return json_tape_push(builder, JSON_TAPE_STRING, offset);
+}
+
+static int32_t json_tape_parse_number(json_tape_builder_t *builder) {
+	json_number_t number;
+	size_t consumed;
+	int res = json_number_scan(builder->buf + builder->pointer, builder->len - builder->pointer, &number, &consumed);
+	if (res) return res == CSON_ERR_INVALID_ARGUMENT ? CSON_PARSER_STATE_INVALID_CHARACTER : res;
+	builder->pointer += consumed;
+	switch (number.num_type) {
+		case JSON_NUMBER_TYPE_I64: return json_tape_push_raw(builder, JSON_TAPE_I64, (uint64_t)number.i64);
+		case JSON_NUMBER_TYPE_U64: return json_tape_push_raw(builder, JSON_TAPE_U64, number.u64);
+		default: {
+			uint64_t raw;
+			memcpy(&raw, &number.f64, sizeof(raw));
+			return json_tape_push_raw(builder, JSON_TAPE_F64, raw);
+		}
+	}
+}
+
+static int32_t json_tape_parse_literal(json_tape_builder_t *builder, const char *const literal, size_t length, json_tape_type_t type) {
+	if (builder->len - builder->pointer < length || memcmp(builder->buf + builder->pointer, literal, length)) {
+		json_error("Found invalid literal at index %zu", builder->pointer);
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	builder->pointer += length;
+	return json_tape_push(builder, type, 0);
+}
+
+static int32_t json_tape_build(json_tape_builder_t *builder) {
+	int res = 0;
+	json_tape_t *tape = builder->tape;
+	json_tape_skip_whitespace(builder);
+	value:
+	if (builder->pointer >= builder->len) {
+		json_error("Unexpected end of input");
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	switch (builder->buf[builder->pointer]) {
+		case '{': {
+			res = json_tape_open(builder, JSON_TAPE_OBJECT_START);
+			if (res) return res;
+			json_tape_skip_whitespace(builder);
+			if (builder->pointer < builder->len && builder->buf[builder->pointer] == '}') {
+				res = json_tape_close(builder, JSON_TAPE_OBJECT_END);
+				if (res) return res;
+				goto end_of_value;
+			}
+			goto key;
+		}
+		case '[': {
+			res = json_tape_open(builder, JSON_TAPE_ARRAY_START);
+			if (res) return res;
+			json_tape_skip_whitespace(builder);
+			if (builder->pointer < builder->len && builder->buf[builder->pointer] == ']') {
+				res = json_tape_close(builder, JSON_TAPE_ARRAY_END);
+				if (res) return res;
+				goto end_of_value;
+			}
+			goto value;
+		}
+		case '"': res = json_tape_parse_string(builder); break;
+		case 't': res = json_tape_parse_literal(builder, "true", 4, JSON_TAPE_TRUE); break;
+		case 'f': res = json_tape_parse_literal(builder, "false", 5, JSON_TAPE_FALSE); break;
+		case 'n': res = json_tape_parse_literal(builder, "null", 4, JSON_TAPE_NULL); break;
+		case '-':
+		case '0' ... '9': res = json_tape_parse_number(builder); break;
+		default: {
+			json_error("Found illegal character \'%c\' at index %zu", builder->buf[builder->pointer], builder->pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+	}
+	if (res) return res;
+	end_of_value:
+	json_tape_skip_whitespace(builder);
+	if (builder->open == JSON_TAPE_NO_PARENT) {
+		if (builder->pointer != builder->len) {
+			json_error("Found trailing character \'%c\' at index %zu", builder->buf[builder->pointer], builder->pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		return 0;
+	}
+	if (builder->pointer >= builder->len) {
+		json_error("Unexpected end of input");
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	char ch = builder->buf[builder->pointer];
+	if (json_tape_type(tape, builder->open) == JSON_TAPE_OBJECT_START) {
+		if (ch == '}') {
+			res = json_tape_close(builder, JSON_TAPE_OBJECT_END);
+			if (res) return res;
+			goto end_of_value;
+		}
+		if (ch != ',') {
+			json_error("Expected \',\' or \'}\' at index %zu", builder->pointer);
+			return CSON_PARSER_STATE_INVALID_CHARACTER;
+		}
+		builder->pointer++;
+		json_tape_skip_whitespace(builder);
+		goto key;
+	}
+	if (ch == ']') {
+		res = json_tape_close(builder, JSON_TAPE_ARRAY_END);
+		if (res) return res;
+		goto end_of_value;
+	}
+	if (ch != ',') {
+		json_error("Expected \',\' or \']\' at index %zu", builder->pointer);
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	builder->pointer++;
+	json_tape_skip_whitespace(builder);
+	goto value;
+	key:
+	if (builder->pointer >= builder->len || builder->buf[builder->pointer] != '"') {
+		json_error("Expected key at index %zu", builder->pointer);
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	res = json_tape_parse_string(builder);
+	if (res) return res;
+	json_tape_skip_whitespace(builder);
+	if (builder->pointer >= builder->len || builder->buf[builder->pointer] != ':') {
+		json_error("Expected \':\' at index %zu", builder->pointer);
+		return CSON_PARSER_STATE_INVALID_CHARACTER;
+	}
+	builder->pointer++;
+	json_tape_skip_whitespace(builder);
+	goto value;
+}
+
+int32_t json_parse_tape(json_tape_t *tape, const char *const data, size_t len, const json_allocator_t *allocator) {
+	if (!tape || !data) return CSON_ERR_NULL_PTR;
+	*tape = (json_tape_t){
+		.allocator = json_allocator_resolve(allocator)
+	};
+	// A value costs at most one word per input byte (plus one for a number followed
+	// by the closing bracket), a string at most its quotes worth of extra bytes and a
+	// length prefix, escapes only ever shrink it.
+	size_t word_capacity = len + 2;
+	size_t string_capacity = len + (len / 2 + 1) * (sizeof(uint32_t) + 1);
+	if (word_capacity > (SIZE_MAX - string_capacity) / sizeof(uint64_t)) return CSON_ERR_MAX_SIZE_REACHED;
+	tape->size = word_capacity * sizeof(uint64_t) + string_capacity;
+	tape->words = json_allocator_malloc(tape->allocator, tape->size);
+	if (!tape->words) {
+		json_error("Failed to allocate tape with size %zu byte(s)", tape->size);
+		return CSON_ERR_ALLOC;
+	}
+	tape->strings = (char *)(tape->words + word_capacity);
+	json_tape_builder_t builder = {
+		.tape = tape,
+		.buf = data,
+		.len = len,
+		.word_capacity = word_capacity,
+		.open = JSON_TAPE_NO_PARENT
+	};
+	int res = json_tape_build(&builder);
+	if (res) json_tape_free(tape);
+	return res;
+}
+
+int32_t json_tape_free(json_tape_t *tape) {
+	if (!tape) return CSON_ERR_NULL_PTR;
+	if (tape->words) json_allocator_free(tape->allocator, tape->words, tape->size);
+	*tape = (json_tape_t){};
+	return 0;
+}
@@ -0,0 +1,23 @@
+#include "../include/cson_common.h"
+#include <stdarg.h>
+
+static json_trace_sink_t trace_sink;
+static void *trace_user_data;
+
+void json_trace_set_sink(json_trace_sink_t sink, void *user_data) {
+	trace_sink = sink;
+	trace_user_data = user_data;
+}
+
+void json_trace_write(int32_t level, const char *const file, int32_t line, const char *const format, ...) {
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	if (trace_sink) {
+		trace_sink(level, file, line, message, trace_user_data);
+		return;
+	}
+	fprintf(stderr, LOG_STRING"%s\n", file, line, message);
+}
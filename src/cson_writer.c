@@ -0,0 +1,289 @@
+#include "../include/cson_writer.h"
+#include "../include/cson_simd.h"
+#include "../include/cson_number.h"
+#include <math.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif // _WIN32
+
+typedef struct {
+	json_writer_t *out;
+	bool pretty;
+	char indent_char;
+	size_t indent_width;
+} json_serializer_t;
+
+int32_t json_writer_init_buffer(json_writer_t *writer, size_t size, const json_allocator_t *allocator) {
+	if (!writer) return CSON_ERR_NULL_PTR;
+	*writer = (json_writer_t){
+		.size = size ? size : CSON_WRITER_BUFFER_SIZE,
+		.fd = -1,
+		.allocator = json_allocator_resolve(allocator)
+	};
+	writer->buf = json_allocator_malloc(writer->allocator, writer->size);
+	if (!writer->buf) {
+		json_error("Failed to allocate writer buffer with size %zu byte(s)", writer->size);
+		writer->size = 0;
+		return CSON_ERR_ALLOC;
+	}
+	return 0;
+}
+
+int32_t json_writer_init_fd(json_writer_t *writer, int fd, const json_allocator_t *allocator) {
+	if (!writer) return CSON_ERR_NULL_PTR;
+	if (fd < 0) return CSON_ERR_INVALID_ARGUMENT;
+	int res = json_writer_init_buffer(writer, CSON_WRITER_BUFFER_SIZE, allocator);
+	if (res) return res;
+	writer->fd = fd;
+	return 0;
+}
+
+// Hands data[0, length) to the descriptor, however many write calls that takes.
+static int32_t json_writer_drain(json_writer_t *writer, const char *data, size_t length) {
+	while (length) {
+#ifdef _WIN32
+		int n = _write(writer->fd, data, length > INT32_MAX ? INT32_MAX : (unsigned int)length);
+#else
+		ssize_t n = write(writer->fd, data, length);
+#endif // _WIN32
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			json_error("Failed to write %zu byte(s) to descriptor %d", length, writer->fd);
+			return errno;
+		}
+		data += n;
+		length -= n;
+	}
+	return 0;
+}
+
+int32_t json_writer_flush(json_writer_t *writer) {
+	if (!writer) return CSON_ERR_NULL_PTR;
+	if (writer->fd < 0 || !writer->length) return 0;
+	int res = json_writer_drain(writer, writer->buf, writer->length);
+	if (res) return res;
+	writer->length = 0;
+	return 0;
+}
+
+// Doubles a memory writer's buffer until `length` more bytes fit.
+static int32_t json_writer_grow(json_writer_t *writer, size_t length) {
+	size_t size = writer->size ? writer->size : CSON_WRITER_BUFFER_SIZE;
+	while (size - writer->length < length) {
+		if (size > SIZE_MAX / 2) return CSON_ERR_MAX_SIZE_REACHED;
+		size *= 2;
+	}
+	char *buf = writer->buf
+		? json_allocator_realloc(writer->allocator, writer->buf, writer->size, size)
+		: json_allocator_malloc(writer->allocator, size);
+	if (!buf) {
+		json_error("Failed to grow writer buffer with length %zu to %zu byte(s)", writer->length, size);
+		return CSON_ERR_ALLOC;
+	}
+	writer->buf = buf;
+	writer->size = size;
+	return 0;
+}
+
+// Room for `length` more bytes in the buffer, which a descriptor writer always
+// has once flushed as long as `length` is below CSON_WRITER_BUFFER_SIZE.
+static inline int32_t json_writer_reserve(json_writer_t *writer, size_t length) {
+	if (writer->size - writer->length >= length) return 0;
+	if (writer->fd < 0) return json_writer_grow(writer, length);
+	return json_writer_flush(writer);
+}
+
+int32_t json_writer_write(json_writer_t *writer, const char *const data, size_t length) {
+	if (!writer || (!data && length)) return CSON_ERR_NULL_PTR;
+	if (writer->size - writer->length < length) {
+		if (writer->fd < 0) {
+			int res = json_writer_grow(writer, length);
+			if (res) return res;
+		} else {
+			int res = json_writer_flush(writer);
+			if (res) return res;
+			// Too large to be worth a copy.
+			if (length > writer->size) return json_writer_drain(writer, data, length);
+		}
+	}
+	memcpy(writer->buf + writer->length, data, length);
+	writer->length += length;
+	return 0;
+}
+
+static inline int32_t json_writer_put_char(json_writer_t *writer, char ch) {
+	if (writer->length == writer->size) {
+		int res = json_writer_reserve(writer, 1);
+		if (res) return res;
+	}
+	writer->buf[writer->length++] = ch;
+	return 0;
+}
+
+static int32_t json_serialize_newline(const json_serializer_t *s, uint64_t depth) {
+	int res = json_writer_put_char(s->out, '\n');
+	size_t count = depth * s->indent_width;
+	while (!res && count) {
+		size_t n = count < 256 ? count : 256;
+		res = json_writer_reserve(s->out, n);
+		if (res) break;
+		memset(s->out->buf + s->out->length, s->indent_char, n);
+		s->out->length += n;
+		count -= n;
+	}
+	return res;
+}
+
+// Plain runs are found with the same scan the parser uses for string bodies and
+// copied whole, only quotes, backslashes and control characters are escaped.
+static int32_t json_serialize_string(json_writer_t *out, const char *data, size_t length) {
+	static const char hex[] = "0123456789abcdef";
+	int res = json_writer_put_char(out, '\"');
+	while (!res && length) {
+		size_t run = json_simd_find_string_special(data, length);
+		res = json_writer_write(out, data, run);
+		if (res || run == length) break;
+		unsigned char ch = data[run];
+		char escape[6] = { '\\', (char)ch };
+		size_t n = 2;
+		switch (ch) {
+			case '\"':
+			case '\\': break;
+			case '\b': escape[1] = 'b'; break;
+			case '\f': escape[1] = 'f'; break;
+			case '\n': escape[1] = 'n'; break;
+			case '\r': escape[1] = 'r'; break;
+			case '\t': escape[1] = 't'; break;
+			default: {
+				memcpy(escape + 1, "u00", 3);
+				escape[4] = hex[ch >> 4];
+				escape[5] = hex[ch & 0xF];
+				n = 6;
+			}
+		}
+		res = json_writer_write(out, escape, n);
+		data += run + 1;
+		length -= run + 1;
+	}
+	if (res) return res;
+	return json_writer_put_char(out, '\"');
+}
+
+// Writes the digits of `value` backwards, ending right before `end`, two at a time.
+static char *json_serialize_u64_digits(char *end, uint64_t value) {
+	static const char pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	while (value >= 100) {
+		unsigned int pair = (unsigned int)(value % 100) * 2;
+		value /= 100;
+		*--end = pairs[pair + 1];
+		*--end = pairs[pair];
+	}
+	if (value >= 10) {
+		*--end = pairs[value * 2 + 1];
+		*--end = pairs[value * 2];
+	} else {
+		*--end = (char)('0' + value);
+	}
+	return end;
+}
+
+static int32_t json_serialize_number(json_writer_t *out, const json_value_t *const value) {
+	char buf[CSON_NUMBER_F64_MAX_LENGTH];
+	char *end = buf + sizeof(buf);
+	char *start;
+	switch (value->num_type) {
+		case JSON_NUMBER_TYPE_U64: {
+			start = json_serialize_u64_digits(end, value->u64);
+		} break;
+		case JSON_NUMBER_TYPE_I64: {
+			start = json_serialize_u64_digits(end, value->i64 < 0 ? 0 - (uint64_t)value->i64 : (uint64_t)value->i64);
+			if (value->i64 < 0) *--start = '-';
+		} break;
+		case JSON_NUMBER_TYPE_F64: {
+			if (!isfinite(value->f64)) return json_writer_write(out, "null", 4);
+			start = buf;
+			end = buf + json_number_format_f64(value->f64, buf);
+		} break;
+		default: return CSON_ERR_INVALID_ARGUMENT;
+	}
+	return json_writer_write(out, start, end - start);
+}
+
+static int32_t json_serialize_value(const json_serializer_t *s, const json_value_t *const value, uint64_t depth) {
+	json_writer_t *out = s->out;
+	int res = 0;
+	switch (value->value_type) {
+		case JSON_OBJECT_TYPE_OBJECT: {
+			const json_object_t *obj = value->object;
+			if (!obj || (!obj->buckets && obj->count)) return CSON_ERR_NULL_PTR;
+			res = json_writer_put_char(out, '{');
+			for (ssize_t i = 0; !res && i < obj->count; ++i) {
+				const json_bucket_t *bucket = &obj->buckets[i];
+				if (i) res = json_writer_put_char(out, ',');
+				if (!res && s->pretty) res = json_serialize_newline(s, depth + 1);
+				if (!res) res = json_serialize_string(out, json_string_data(&bucket->key), bucket->key.length);
+				if (!res) res = s->pretty ? json_writer_write(out, ": ", 2) : json_writer_put_char(out, ':');
+				if (!res) res = json_serialize_value(s, &bucket->value, depth + 1);
+			}
+			if (!res && s->pretty && obj->count) res = json_serialize_newline(s, depth);
+			if (!res) res = json_writer_put_char(out, '}');
+		} break;
+		case JSON_OBJECT_TYPE_ARRAY: {
+			const json_array_t *arr = value->array;
+			if (!arr || (!arr->objects && arr->length)) return CSON_ERR_NULL_PTR;
+			res = json_writer_put_char(out, '[');
+			for (ssize_t i = 0; !res && i < arr->length; ++i) {
+				if (i) res = json_writer_put_char(out, ',');
+				if (!res && s->pretty) res = json_serialize_newline(s, depth + 1);
+				if (!res) res = json_serialize_value(s, &arr->objects[i], depth + 1);
+			}
+			if (!res && s->pretty && arr->length) res = json_serialize_newline(s, depth);
+			if (!res) res = json_writer_put_char(out, ']');
+		} break;
+		case JSON_OBJECT_TYPE_STRING: {
+			json_string_t string = json_value_string(value);
+			res = json_serialize_string(out, string.buf, string.length);
+		} break;
+		case JSON_OBJECT_TYPE_BOOL: {
+			res = value->boolean ? json_writer_write(out, "true", 4) : json_writer_write(out, "false", 5);
+		} break;
+		case JSON_OBJECT_TYPE_NUMBER: {
+			res = json_serialize_number(out, value);
+		} break;
+		case JSON_OBJECT_TYPE_NULL: {
+			res = json_writer_write(out, "null", 4);
+		} break;
+		default: {
+			return CSON_ERR_INVALID_ARGUMENT;
+		}
+	}
+	return res;
+}
+
+int32_t json_serialize(const json_value_t *const value, json_writer_t *out, uint32_t flags) {
+	if (!value || !out) return CSON_ERR_NULL_PTR;
+	size_t spaces = (flags >> 8) & 0xFF;
+	json_serializer_t s = {
+		.out = out,
+		.pretty = flags & CSON_SERIALIZE_PRETTY,
+		.indent_char = spaces ? ' ' : '\t',
+		.indent_width = spaces ? spaces : 1
+	};
+	int res = json_serialize_value(&s, value, 0);
+	if (res) return res;
+	return json_writer_flush(out);
+}
+
+int32_t json_writer_free(json_writer_t *writer) {
+	if (!writer) return CSON_ERR_NULL_PTR;
+	if (writer->buf) json_allocator_free(writer->allocator, writer->buf, writer->size);
+	*writer = (json_writer_t){
+		.fd = -1
+	};
+	return 0;
+}